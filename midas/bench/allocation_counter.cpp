@@ -0,0 +1,21 @@
+#include "bench.h"
+
+#include <cstdlib>
+#include <new>
+
+// Kept out of midas_bench.cpp so the replacements are never inlined into
+// the code they count
+
+std::atomic<uint64_t> g_allocations { 0 };
+
+void *operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(std::max<size_t>(size, 1))) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t) noexcept { std::free(p); }
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Incremented by every operator new, see allocation_counter.cpp
+extern std::atomic<uint64_t> g_allocations;
+
+struct BenchResult {
+  std::string name;
+  std::string corpus;
+  uint64_t ops; // Operations per repetition
+  double ns_per_op; // Mean over the repetitions
+  double stddev_ns;
+  double allocs_per_op;
+  PerfCounters::Values counters; // Per operation, NaN when not counted
+};
+
+// Times an operation in repetitions of a calibrated number of calls and
+// reports the mean time per call, its spread between repetitions and the
+// allocations per call. The hardware counters, when the system provides
+// them, are read over all the repetitions.
+class BenchRunner final {
+ public:
+  BenchRunner(const std::string& filter, int repetitions, std::chrono::milliseconds min_time, bool use_counters)
+      : filter_(filter), repetitions_(repetitions), min_time_(min_time) {
+    if (use_counters) {
+      counters_ = std::make_unique<PerfCounters>();
+      if (!counters_->IsAvailable()) {
+        std::cout << "Hardware counters are not available, only timing" << std::endl;
+        counters_.reset();
+      }
+    }
+  }
+
+  // op(i) runs the i:th operation, e.g. on board i of a corpus, and returns a
+  // value that goes into a checksum so the compiler cannot drop the work
+  template<class Op>
+  void Run(const std::string& name, const std::string& corpus, Op op) {
+    if (!filter_.empty() && (name + "/" + corpus).find(filter_) == std::string::npos) {
+      return;
+    }
+    uint64_t ops = 1;
+
+    // Grow the repetition until it takes min_time, so timer resolution and
+    // loop overhead do not matter
+    for (double ns = TimeRepetition(op, ops); ns < Nanoseconds(min_time_) && ops < (1ull << 32);) {
+      ops = static_cast<uint64_t>(ops * std::clamp(1.2 * Nanoseconds(min_time_) / std::max(ns, 1.0), 1.5, 100.0));
+      ns = TimeRepetition(op, ops);
+    }
+    std::vector<double> samples;
+    const uint64_t allocations = g_allocations;
+    PerfCounters::Values counters;
+
+    counters.fill(std::numeric_limits<double>::quiet_NaN());
+    if (counters_) {
+      counters_->Start();
+    }
+    for (int repetition = 0; repetition < repetitions_; ++repetition) {
+      samples.push_back(TimeRepetition(op, ops) / ops);
+    }
+    if (counters_) {
+      counters = counters_->Stop();
+    }
+    for (auto& value : counters) {
+      value /= static_cast<double>(ops * repetitions_);
+    }
+    const double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    const double variance = std::accumulate(samples.begin(), samples.end(), 0.0, [mean](double sum, double s) { return sum + (s - mean) * (s - mean); }) / samples.size();
+    const BenchResult result { name, corpus, ops, mean, std::sqrt(variance), static_cast<double>(g_allocations - allocations) / (ops * repetitions_), counters };
+
+    std::cout << std::left << std::setw(32) << name << std::setw(12) << corpus << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << result.ns_per_op << " ns/op +- " << std::setw(5) << 100.0 * result.stddev_ns / result.ns_per_op << "%"
+              << std::setprecision(2) << std::setw(10) << result.allocs_per_op << " allocs/op";
+    if (counters_) {
+      std::cout << std::setprecision(1) << std::setw(10) << counters[PerfCounters::Cycles] << " cycles" << std::setw(10)
+                << counters[PerfCounters::Instructions] << " instr" << std::setprecision(2) << std::setw(6)
+                << counters[PerfCounters::Instructions] / counters[PerfCounters::Cycles] << " IPC" << std::setw(8)
+                << counters[PerfCounters::BranchMisses] << " br-miss" << std::setw(8) << counters[PerfCounters::L1DMisses]
+                << " L1d-miss" << std::setw(8) << counters[PerfCounters::LLCMisses] << " LLC-miss";
+    }
+    std::cout << std::endl;
+    results_.push_back(result);
+  }
+
+  bool WriteJson(const std::string& file) const {
+    std::ofstream fs(file);
+
+    fs << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results_.size(); ++i) {
+      const auto& r = results_[i];
+
+      fs << "    { \"name\": \"" << r.name << "\", \"corpus\": \"" << r.corpus << "\", \"ops\": " << r.ops
+         << ", \"ns_per_op\": " << r.ns_per_op << ", \"stddev_ns\": " << r.stddev_ns
+         << ", \"allocs_per_op\": " << r.allocs_per_op;
+      // JSON has no NaN, counters that were not read are left out
+      for (int c = 0; c < PerfCounters::kCounters; ++c) {
+        if (!std::isnan(r.counters[c])) {
+          fs << ", \"" << PerfCounters::GetName(static_cast<PerfCounters::Counter>(c)) << "_per_op\": " << r.counters[c];
+        }
+      }
+      fs << " }" << ((i + 1 < results_.size()) ? "," : "") << "\n";
+    }
+    fs << "  ],\n  \"checksum\": " << checksum_ << "\n}\n";
+
+    return fs.good();
+  }
+
+  uint64_t GetChecksum() const { return checksum_; }
+
+ protected:
+  static double Nanoseconds(std::chrono::milliseconds ms) { return std::chrono::duration<double, std::nano>(ms).count(); }
+
+  template<class Op>
+  double TimeRepetition(Op& op, uint64_t ops) {
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < ops; ++i) {
+      checksum_ += static_cast<uint64_t>(op(i));
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  }
+
+ private:
+  std::string filter_;
+  int repetitions_;
+  std::chrono::milliseconds min_time_;
+  uint64_t checksum_ = 0;
+  std::vector<BenchResult> results_;
+  std::unique_ptr<PerfCounters> counters_;
+};
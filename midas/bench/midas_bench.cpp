@@ -0,0 +1,268 @@
+#include "bench.h"
+#include "board_batch.h"
+#include "grid.h"
+#include "headless_asset_manager.h"
+#include "history.h"
+
+#include <random>
+
+namespace {
+
+const int kCorpusSize = 64;
+const int kCells = kRows * kCols;
+const size_t kSparseMoves = 16;
+
+// A settled board and a move on it that sets off at least two cascades
+struct CascadeCase {
+  Grid board;
+  Position p1;
+  Position p2;
+  GridSnapshot holes; // The board after the swap with the matches removed
+};
+
+void RemoveMatches(Grid& grid, ScoreRules& score, const std::vector<Position>& matches, int chains) {
+  static const Element empty(SpriteID::Empty);
+
+  score.Update(std::set<Position>(matches.begin(), matches.end()).size(), chains);
+  for (const auto& p : matches) {
+    grid.At(p) = empty;
+  }
+}
+
+// Settled boards from the sparse end of what a game sees, about one in ten
+// new boards has this few moves
+std::vector<Grid> SparseCorpus(HeadlessAssetManager& assets) {
+  std::vector<Grid> corpus;
+
+  for (uint64_t seed = 1; corpus.size() < kCorpusSize; ++seed) {
+    Grid grid(kRows, kCols, &assets, seed);
+    ScoreRules score;
+
+    grid.ResolveCascades(score);
+    if (grid.EnumerateMoves().size() <= kSparseMoves) {
+      corpus.push_back(grid);
+    }
+  }
+  return corpus;
+}
+
+// Boards of independently drawn pieces, full of matches like a board right
+// after a large refill
+std::vector<Grid> DenseCorpus(HeadlessAssetManager& assets) {
+  std::vector<Grid> corpus;
+  PieceGenerator generator(1);
+
+  while (corpus.size() < kCorpusSize) {
+    std::vector<std::vector<int>> cells(kRows, std::vector<int>(kCols));
+
+    for (auto& row : cells) {
+      for (auto& cell : row) {
+        cell = generator.Next();
+      }
+    }
+    corpus.emplace_back(cells, &assets);
+  }
+  return corpus;
+}
+
+std::vector<CascadeCase> CascadeCorpus(HeadlessAssetManager& assets) {
+  std::vector<CascadeCase> corpus;
+
+  for (uint64_t seed = 1; corpus.size() < kCorpusSize; ++seed) {
+    Grid grid(kRows, kCols, &assets, seed);
+    ScoreRules score;
+
+    grid.ResolveCascades(score);
+    for (const auto& move : grid.EnumerateMoves()) {
+      Grid after(grid);
+      auto [matches, chains] = after.GetMatchesFromSwap(move.p1, move.p2);
+
+      std::swap(after.At(move.p1), after.At(move.p2));
+      RemoveMatches(after, score, matches, chains);
+
+      GridSnapshot holes;
+
+      after.Snapshot(holes);
+      if (after.ResolveCascades(score).steps.size() >= 2) {
+        corpus.push_back({ grid, move.p1, move.p2, holes });
+        break;
+      }
+    }
+  }
+  return corpus;
+}
+
+// What Board does, one Collaps per frame until nothing moves
+int CollapsToStability(Grid& grid, ScoreRules& score) {
+  for (;;) {
+    auto [moved_objects, matches, chains] = grid.Collaps(score.GetConsecutiveMatchesRef(), score.GetPreviousConsecutiveMatchesRef());
+
+    if (!matches.empty()) {
+      RemoveMatches(grid, score, matches, chains);
+    } else if (moved_objects.empty()) {
+      return score.Get();
+    }
+  }
+}
+
+SpriteID RejectionSample(SpriteID not_this, SpriteID nor_this, std::mt19937& engine) {
+  std::uniform_int_distribution<int> distribution(0, kNumSprites - 1);
+  SpriteID id;
+
+  do {
+    id = static_cast<SpriteID>(distribution(engine));
+  } while (id == not_this || id == nor_this);
+
+  return id;
+}
+
+void PrintUsage() {
+  std::cout << "Usage: midas_bench [options]\n"
+            << "  --filter=<text>       Only run benchmarks whose name/corpus contains the text\n"
+            << "  --repetitions=<n>     Timed repetitions per benchmark, default 10\n"
+            << "  --min-time=<ms>       Minimum time of a repetition, default 20\n"
+            << "  --json=<file>         Also write the results as JSON\n"
+            << "  --no-counters         Do not read the hardware counters, only time" << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  std::string filter;
+  std::string json;
+  int repetitions = 10;
+  int min_time = 20;
+  bool use_counters = true;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const auto pos = arg.find('=');
+    const std::string key = arg.substr(0, pos);
+    const std::string value = (pos == std::string::npos) ? "" : arg.substr(pos + 1);
+
+    if (key == "--filter") {
+      filter = value;
+    } else if (key == "--no-counters") {
+      use_counters = false;
+    } else if (key == "--json") {
+      json = value;
+    } else if (key == "--repetitions" && std::atoi(value.c_str()) > 0) {
+      repetitions = std::atoi(value.c_str());
+    } else if (key == "--min-time" && std::atoi(value.c_str()) > 0) {
+      min_time = std::atoi(value.c_str());
+    } else {
+      PrintUsage();
+      exit((key == "--help") ? 0 : -1);
+    }
+  }
+  HeadlessAssetManager assets;
+  auto sparse = SparseCorpus(assets);
+  auto dense = DenseCorpus(assets);
+  const auto cascade = CascadeCorpus(assets);
+  std::vector<Grid> cascade_boards;
+  BenchRunner runner(filter, repetitions, std::chrono::milliseconds(min_time), use_counters);
+
+  for (const auto& c : cascade) {
+    cascade_boards.push_back(c.board);
+  }
+  for (const auto& [corpus, grids] : { std::make_pair("sparse", &sparse), std::make_pair("dense", &dense) }) {
+    runner.Run("GetAllMatches", corpus, [grids = grids](uint64_t i) {
+      return (*grids)[i % kCorpusSize].GetAllMatches().first.size();
+    });
+    runner.Run("IsMatch", corpus, [grids = grids](uint64_t i) {
+      const int cell = static_cast<int>(i % kCells);
+
+      return (*grids)[(i / kCells) % kCorpusSize].IsMatch(cell / kCols, cell % kCols);
+    });
+  }
+  for (const auto& [corpus, grids] : { std::make_pair("sparse", &sparse), std::make_pair("cascade", &cascade_boards) }) {
+    runner.Run("GetMatchesFromSwap", corpus, [grids = grids](uint64_t i) {
+      const auto [p1, p2] = BoardBatch::GetMove(static_cast<int>(i % BoardBatch::kMoves));
+
+      return (*grids)[(i / BoardBatch::kMoves) % kCorpusSize].GetMatchesFromSwap(Position(p1.first, p1.second), Position(p2.first, p2.second)).first.size();
+    });
+    runner.Run("FindPotentialMatches", corpus, [grids = grids](uint64_t i) {
+      return (*grids)[i % kCorpusSize].FindPotentialMatches().first;
+    });
+    runner.Run("EnumerateMoves", corpus, [grids = grids](uint64_t i) {
+      return (*grids)[i % kCorpusSize].EnumerateMoves().size();
+    });
+  }
+  Grid work(cascade.front().board);
+
+  runner.Run("Restore", "cascade", [&](uint64_t i) {
+    work.Restore(cascade[i % kCorpusSize].holes);
+    return work.At(0, 0).id();
+  });
+  runner.Run("Restore+CollapsToStability", "cascade", [&](uint64_t i) {
+    ScoreRules score;
+
+    work.Restore(cascade[i % kCorpusSize].holes);
+    return CollapsToStability(work, score);
+  });
+  runner.Run("Restore+ResolveCascades", "cascade", [&](uint64_t i) {
+    ScoreRules score;
+
+    work.Restore(cascade[i % kCorpusSize].holes);
+    return work.ResolveCascades(score).score_delta;
+  });
+  runner.Run("Generate", "-", [&](uint64_t) {
+    work.Generate(Grid::GenerateType::NoFill);
+    return work.At(0, 0).id();
+  });
+  runner.Run("Snapshot", "cascade", [&](uint64_t i) {
+    GridSnapshot snapshot;
+
+    cascade_boards[i % kCorpusSize].Snapshot(snapshot);
+    return snapshot.cells[i % kCells];
+  });
+
+  GameHistory history;
+  std::vector<GameSnapshot> states(kCorpusSize);
+
+  for (int i = 0; i < kCorpusSize; ++i) {
+    cascade_boards[i].Snapshot(states[i].grid);
+  }
+  runner.Run("GameHistory::Record", "cascade", [&](uint64_t i) {
+    history.Record(states[i % kCorpusSize]);
+    return history.size();
+  });
+
+  PieceGenerator generator(1);
+  std::mt19937 engine(1);
+
+  runner.Run("PieceGenerator::NextExcept", "-", [&](uint64_t i) {
+    return generator.NextExcept(static_cast<SpriteID>(i % kNumSprites), SpriteID::Empty);
+  });
+  runner.Run("mt19937+rejection", "-", [&](uint64_t i) {
+    return RejectionSample(static_cast<SpriteID>(i % kNumSprites), SpriteID::Empty, engine);
+  });
+
+  // One op is a step of every board in the batch
+  const int kBoards = 4096;
+  BoardBatch batch(kBoards, 1);
+  BoardBatch::StepResult result;
+  std::vector<int> moves(kBoards);
+
+  batch.GetValidMoves(result.valid_moves);
+  runner.Run("BoardBatch::Step", "4096 boards", [&](uint64_t i) {
+    for (int board = 0; board < kBoards; ++board) {
+      const uint8_t *valid = &result.valid_moves[board * BoardBatch::kMoves];
+      int move = static_cast<int>((i * 31 + board) % BoardBatch::kMoves);
+
+      while (!valid[move]) {
+        move = (move + 1) % BoardBatch::kMoves;
+      }
+      moves[board] = move;
+    }
+    batch.Step(moves, result);
+
+    return result.rewards[0];
+  });
+  std::cout << "Checksum: " << runner.GetChecksum() << std::endl;
+  if (!json.empty() && !runner.WriteJson(json)) {
+    std::cout << "Failed to write " << json << std::endl;
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters of the calling thread read through perf_event_open.
+// Counters the CPU, the kernel (perf_event_paranoid) or a VM do not provide
+// read as NaN, and on other platforms all of them do, so the benchmarks
+// fall back to timing only. The counts are scaled up when the kernel had
+// to multiplex the counters.
+class PerfCounters final {
+ public:
+  enum Counter { Cycles, Instructions, BranchMisses, L1DMisses, LLCMisses, kCounters };
+
+  using Values = std::array<double, kCounters>;
+
+  static const char *GetName(Counter counter) {
+    static const char *kNames[] = { "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses" };
+
+    return kNames[counter];
+  }
+
+  PerfCounters() {
+    fds_.fill(-1);
+#if defined(__linux__)
+    const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const std::array<std::pair<uint32_t, uint64_t>, kCounters> events = { {
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+      { PERF_TYPE_HW_CACHE, l1d_read_miss },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    } };
+
+    for (int i = 0; i < kCounters; ++i) {
+      perf_event_attr attr {};
+
+      attr.size = sizeof(attr);
+      attr.type = events[i].first;
+      attr.config = events[i].second;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+
+  ~PerfCounters() {
+#if defined(__linux__)
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+#endif
+  }
+
+  bool IsAvailable() const {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Start() {
+#if defined(__linux__)
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+  }
+
+  Values Stop() {
+    Values values;
+
+    values.fill(std::numeric_limits<double>::quiet_NaN());
+#if defined(__linux__)
+    for (int i = 0; i < kCounters; ++i) {
+      uint64_t data[3]; // Value, time enabled and time running
+
+      if (fds_[i] < 0) {
+        continue;
+      }
+      ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fds_[i], data, sizeof(data)) == sizeof(data) && data[2] > 0) {
+        values[i] = static_cast<double>(data[0]) * data[1] / data[2];
+      }
+    }
+#endif
+    return values;
+  }
+
+ private:
+  std::array<int, kCounters> fds_;
+};
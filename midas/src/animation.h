@@ -3,6 +3,7 @@
 #include "grid.h"
 #include "score.h"
 #include "text.h"
+#include "trace.h"
 
 namespace {
 
@@ -11,7 +12,7 @@ const double kTimeResolution = static_cast<double>(1.0 / kFPS);
 std::pair<int, int> FindPositionForScoreAnimation(const std::vector<Position>& c_matches) {
   // If diamonds are overlapping use the overlapping diamond position
   // as score position
-  auto matches = c_matches;
+  ArenaVector<Position> matches(c_matches.begin(), c_matches.end(), GetFrameArena());
 
   while (!matches.empty()) {
     auto match = matches.back();
@@ -71,11 +72,11 @@ public:
   const Audio& GetAudio() const { return asset_manager_->GetAudio(); }
 
   void RenderCopy(SpriteID id, const SDL_Rect &rc) {
-    SDL_RenderCopy(*this, asset_manager_->GetSpriteAsTexture(id), nullptr, &rc);
+    CountedRenderCopy(*this, asset_manager_->GetSpriteAsTexture(id), nullptr, &rc);
   }
 
   void RenderCopy(SDL_Texture *texture, const SDL_Rect &rc) {
-    SDL_RenderCopy(*this, texture, nullptr, &rc);
+    CountedRenderCopy(*this, texture, nullptr, &rc);
   }
 
 protected:
@@ -88,6 +89,9 @@ private:
   std::shared_ptr<AssetManager> asset_manager_;
 };
 
+// The animations started in a frame, in the frame arena
+using Animations = ArenaVector<std::shared_ptr<Animation>>;
+
 class SwapAnimation final : public Animation {
 public:
   SwapAnimation(SDL_Renderer *renderer, Grid &grid, const Position &p1,
@@ -122,6 +126,8 @@ public:
   }
 
   virtual void Update(double delta) override {
+    TRACE_ZONE("SwapAnimation::Update");
+
     const double kSign = (pixels_moved_ < kSpriteWidth) ? 1.0 : -1.0;
     const double kVelocity = delta * 300;
 
@@ -202,6 +208,8 @@ class ScoreAnimation final : public Animation {
   }
 
   virtual void Update(double delta) override {
+    TRACE_ZONE("ScoreAnimation::Update");
+
     SDL_Rect clip_rc;
     SDL_RenderGetClipRect(*this, &clip_rc);
     SDL_RenderSetClipRect(*this, NULL);
@@ -240,6 +248,8 @@ public:
   }
 
   virtual void Update(double delta) override {
+    TRACE_ZONE("MatchAnimation::Update");
+
     if (!lock_board_) {
       score_animation_.Update(delta);
       return;
@@ -300,6 +310,8 @@ public:
   }
 
   virtual void Update(double delta) override {
+    TRACE_ZONE("MoveDownAnimation::Update");
+
     const double kIncY = GetGrid().IsFilling() ? delta * 500 : delta * 350;
 
     rc_.y = static_cast<int>(y_);
@@ -343,6 +355,8 @@ public:
   }
 
   virtual void Update(double delta) override {
+    TRACE_ZONE("HintAnimation::Update");
+
     const double kTwoTimesPi = 2.0 * 3.1415926535897932384626433;
     const double kRadius = kSpriteWidth / 10.0;
 
@@ -374,57 +388,72 @@ private:
 class TimerAnimation final : public Animation {
 public:
   TimerAnimation(SDL_Renderer *renderer, Grid &grid,
-                 std::shared_ptr<AssetManager> &asset_manager)
-      : Animation(renderer, grid, asset_manager), star_textures_(asset_manager->GetStarTextures()) {}
+                 std::shared_ptr<AssetManager> &asset_manager, TimerWheel& timers)
+      : Animation(renderer, grid, asset_manager), star_textures_(asset_manager->GetStarTextures()), timers_(timers) {
+    Reset();
+  }
 
   virtual void Start() override {}
 
-  virtual void Update(double delta) override {
-    const size_t kTimerStep = static_cast<size_t>(double(kGameTime) / coordinates_.size());
+  virtual void Update(double) override {
+    TRACE_ZONE("TimerAnimation::Update");
+
     auto [x, y] = coordinates_[step_];
 
     RenderCopy(star_textures_.at(frame_), { x - 15, y - 15, 30, 30 });
-
-    animation_ticks_ += delta;
-    if (animation_ticks_ >= kTimeResolution) {
-      frame_++;
-      frame_ = (frame_ % star_textures_.size());
-      animation_ticks_ = 0.0;
-    }
-    movement_ticks_ += delta;
-    if (movement_ticks_ > 1.0) {
-      timer_++;
-      if (timer_ % kTimerStep == 0) {
-        step_++;
-      }
-      movement_ticks_ = 0.0;
-    }
-    if (ShouldPlayHurryUp()) {
-      GetAudio().FadeoutMusic(kHurryUpTimeLimit * 1000);
-      GetAudio().PlaySound(HurryUp);
-    }
   }
 
   virtual bool IsReady() override { return timer_ == kGameTime; }
 
   int GetTimeLeft() const { return static_cast<int>(kGameTime - timer_); }
 
-  bool ShouldPlayHurryUp() {
+  int GetElapsedTime() const { return static_cast<int>(timer_); }
+
+  // For a new game, instead of making a new animation
+  void Reset() {
+    frame_ = 0;
+    frame_timer_ = timers_.Every(ToDuration(kTimeResolution), [this] {
+      frame_ = (frame_ + 1) % static_cast<int>(star_textures_.size());
+    });
+    SetElapsedTime(0);
+  }
+
+  // The countdown starts a whole second from now
+  void SetElapsedTime(int seconds) {
+    timer_ = static_cast<size_t>(std::clamp(seconds, 0, kGameTime));
+    step_ = timer_ / static_cast<size_t>(double(kGameTime) / coordinates_.size());
+    hurry_up_played_ = (GetTimeLeft() <= kHurryUpTimeLimit);
+    second_timer_ = timers_.Every(std::chrono::seconds(1), [this] { CountDown(); });
+  }
+
+protected:
+  void CountDown() {
+    const size_t kTimerStep = static_cast<size_t>(double(kGameTime) / coordinates_.size());
+
+    if (IsReady()) {
+      second_timer_.Cancel();
+      return;
+    }
+    timer_++;
+    if (timer_ % kTimerStep == 0) {
+      step_ = std::min(step_ + 1, coordinates_.size() - 1);
+    }
     if (!hurry_up_played_ && GetTimeLeft() <= kHurryUpTimeLimit) {
       hurry_up_played_ = true;
-      return true;
+      GetAudio().FadeoutMusic(kHurryUpTimeLimit * 1000);
+      GetAudio().PlaySound(HurryUp);
     }
-    return false;
   }
 
 private:
   int frame_ = 0;
-  double animation_ticks_ = 0.0;
-  double movement_ticks_ = 0.0;
   size_t timer_ = 0;
   size_t step_ = 0;
   bool hurry_up_played_ = false;
   std::vector<SDL_Texture *> star_textures_;
+  TimerWheel& timers_;
+  TimerWheel::Timer frame_timer_;
+  TimerWheel::Timer second_timer_;
   const std::vector<std::pair<int, int>> coordinates_ = {
       std::make_pair(262, 555), std::make_pair(258, 552),
       std::make_pair(256, 548), std::make_pair(253, 545),
@@ -462,20 +491,18 @@ private:
 class ExplosionAnimation final : public Animation {
 public:
   ExplosionAnimation(SDL_Renderer *renderer, Grid &grid,
-                     std::shared_ptr<AssetManager> &asset_manager)
-      : Animation(renderer, grid, asset_manager), explosion_texture_(asset_manager->GetExplosionTextures()) {}
+                     std::shared_ptr<AssetManager> &asset_manager, TimerWheel& timers)
+      : Animation(renderer, grid, asset_manager), explosion_texture_(asset_manager->GetExplosionTextures()),
+        frame_timer_(timers.Every(ToDuration(kTimeResolution * 5), [this] { frame_++; })) {}
 
   virtual void Start() override {}
 
-  virtual void Update(double delta) override {
+  virtual void Update(double) override {
+    TRACE_ZONE("ExplosionAnimation::Update");
+
     const SDL_Rect rc{ 100, 278, 71, 100 };
 
-    RenderCopy(explosion_texture_.at(frame_), rc);
-    animation_ticks_ += delta;
-    if (animation_ticks_ >= (kTimeResolution * 5)) {
-      frame_++;
-      animation_ticks_ = 0.0;
-    }
+    RenderCopy(explosion_texture_.at(std::min(static_cast<size_t>(frame_), explosion_texture_.size() - 1)), rc);
   }
 
   virtual bool IsReady() override {
@@ -484,15 +511,17 @@ public:
 
 private:
   int frame_ = 0;
-  double animation_ticks_ = 0.0;
   std::vector<SDL_Texture *> explosion_texture_;
+  TimerWheel::Timer frame_timer_;
 };
 
 class ThresholdReachedAnimation final : public Animation {
 public:
   ThresholdReachedAnimation(SDL_Renderer *renderer, Grid &grid,
-                            std::shared_ptr<AssetManager> &asset_manager, int value)
-      : Animation(renderer, grid, asset_manager) {
+                            std::shared_ptr<AssetManager> &asset_manager, TimerWheel& timers, int value)
+      : Animation(renderer, grid, asset_manager),
+        fade_timer_(timers.After(std::chrono::milliseconds(600), [this] { fading_ = true; })),
+        done_timer_(timers.After(std::chrono::seconds(2), [this] { done_ = true; })) {
     const std::string kText = std::to_string(value - (value % kThresholdMultiplier)) + " diamonds cleared";
 
     int width, height;
@@ -505,17 +534,18 @@ public:
   virtual void Start() override { GetAudio().PlaySound(SoundEffect::ThresholdReached); }
 
   virtual void Update(double delta) override {
-    const double kFade = (ticks_ <= 0.6) ? 0.0 : 500.0;
+    TRACE_ZONE("ThresholdReachedAnimation::Update");
+
+    const double kFade = fading_ ? 500.0 : 0.0;
 
     SDL_SetTextureAlphaMod(texture_.get(), static_cast<Uint8>(alpha_));
     RenderCopy(texture_.get(), rc_);
 
     alpha_ -= delta * kFade;
-    ticks_ += delta;
   }
 
   virtual bool IsReady() override {
-    if (ticks_ >= 2.0 || alpha_ <= 0) {
+    if (done_ || alpha_ <= 0) {
       return true;
     }
     return false;
@@ -527,5 +557,8 @@ private:
   double alpha_ = 255.0;
   UniqueTexturePtr texture_;
   SDL_Rect rc_;
-  double ticks_;
+  bool fading_ = false;
+  bool done_ = false;
+  TimerWheel::Timer fade_timer_;
+  TimerWheel::Timer done_timer_;
 };
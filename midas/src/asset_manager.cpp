@@ -1,4 +1,6 @@
 #include "asset_manager.h"
+#include "startup_profiler.h"
+#include "trace.h"
 
 #include <iostream>
 
@@ -14,6 +16,8 @@ const std::string kAssetFolder = "../../assets/";
 #endif
 
 SDL_Texture* LoadTexture(SDL_Renderer *renderer, const std::string& name) {
+  TRACE_ZONE("LoadTexture");
+
   std::string full_path =  kAssetFolder + "art/" + name;
 
   SDL_Surface* surface = SDL_LoadBMP(full_path.c_str());
@@ -21,7 +25,7 @@ SDL_Texture* LoadTexture(SDL_Renderer *renderer, const std::string& name) {
     std::cout << "Failed to load surface " << full_path << " error : " << SDL_GetError() << std::endl;
     exit(-1);
   }
-  SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+  SDL_Texture* texture = CountedCreateTextureFromSurface(renderer, surface);
 
   SDL_FreeSurface(surface);
 
@@ -29,6 +33,8 @@ SDL_Texture* LoadTexture(SDL_Renderer *renderer, const std::string& name) {
 }
 
 TTF_Font *LoadFont(const std::string& name, int size) {
+  TRACE_ZONE("LoadFont");
+
   std::string full_path = kAssetFolder + "fonts/" + name;
 
   TTF_Font *font = TTF_OpenFont(full_path.c_str(), size);
@@ -42,6 +48,8 @@ TTF_Font *LoadFont(const std::string& name, int size) {
 }
 
 std::vector<SDL_Texture*> LoadTextures(SDL_Renderer *renderer, const std::string& name, size_t n) {
+  TRACE_ZONE("LoadTextures");
+
   std::vector<SDL_Texture*> textures;
 
   for (size_t i = 1; i <= n; ++i) {
@@ -54,26 +62,39 @@ std::vector<SDL_Texture*> LoadTextures(SDL_Renderer *renderer, const std::string
 
 void DeleteTexture(SDL_Texture* texture) {
   if (texture != nullptr) {
-    SDL_DestroyTexture(texture);
+    CountedDestroyTexture(texture);
   }
 }
 
 }
 
-AssetManager::AssetManager(SDL_Renderer *renderer) {
+AssetManager::AssetManager(SDL_Renderer *renderer, const AudioConfig& audio_config) : audio_(audio_config) {
+  TRACE_ZONE("AssetManager::AssetManager");
+
   std::vector<SpriteID> ids_ { Blue, Green, Red, Yellow, Purple };
   std::vector<std::string> sprites { "Blue.bmp", "Green.bmp", "Red.bmp", "Yellow.bmp", "Purple.bmp" };
   std::vector<std::string> selected { "BlueSelected.bmp", "GreenSelected.bmp", "RedSelected.bmp", "YellowSelected.bmp", "PurpleSelected.bmp" };
 
-  for (size_t i = 0; i < sprites.size(); ++i) {
-    auto texture = std::shared_ptr<SDL_Texture>(LoadTexture(renderer, sprites[i]), DeleteTexture);
-    auto selected_texture = std::shared_ptr<SDL_Texture>(LoadTexture(renderer, selected[i]), DeleteTexture);
-    sprites_.push_back(std::make_shared<Sprite>(ids_[i], texture, selected_texture));
+  {
+    StartupStage stage("AssetManager: sprites");
+
+    for (size_t i = 0; i < sprites.size(); ++i) {
+      auto texture = std::shared_ptr<SDL_Texture>(LoadTexture(renderer, sprites[i]), DeleteTexture);
+      auto selected_texture = std::shared_ptr<SDL_Texture>(LoadTexture(renderer, selected[i]), DeleteTexture);
+      sprites_.push_back(std::make_shared<Sprite>(ids_[i], texture, selected_texture));
+    }
+    sprites_.push_back(std::make_shared<Sprite>(Empty, nullptr, nullptr));
   }
-  sprites_.push_back(std::make_shared<Sprite>(Empty, nullptr, nullptr));
+  {
+    StartupStage stage("AssetManager: star textures");
 
-  star_textures_ = LoadTextures(renderer, "star", kStarTextures);
-  explosion_texture_ = LoadTextures(renderer, "explosion", kExplosionTextures);
+    star_textures_ = LoadTextures(renderer, "star", kStarTextures);
+  }
+  {
+    StartupStage stage("AssetManager: explosion textures");
+
+    explosion_texture_ = LoadTextures(renderer, "explosion", kExplosionTextures);
+  }
 
   std::vector<std::pair<std::string, int>> fonts {
     std::make_pair("Cabin-Regular.ttf", kNormalFontSize),
@@ -82,13 +103,18 @@ AssetManager::AssetManager(SDL_Renderer *renderer) {
     std::make_pair("Cabin-Bold.ttf", kLargeFontSize)
   };
 
-  std::transform(fonts.begin(), fonts.end(), std::back_inserter(fonts_),
-                 [](const auto& f) { return UniqueFontPtr{ LoadFont(f.first, f.second) }; });
+  {
+    StartupStage stage("AssetManager: fonts");
+
+    std::transform(fonts.begin(), fonts.end(), std::back_inserter(fonts_),
+                   [](const auto& f) { return UniqueFontPtr{ LoadFont(f.first, f.second) }; });
+  }
+  StartupStage stage("AssetManager: background");
 
   background_texture_ = UniqueTexturePtr{ LoadTexture(renderer, "BackGround.bmp") };
 }
 
 AssetManager::~AssetManager() noexcept {
-  std::for_each(std::begin(star_textures_), std::end(star_textures_), [] (auto texture) { SDL_DestroyTexture(texture); });
-  std::for_each(std::begin(explosion_texture_), std::end(explosion_texture_), [] (auto texture) { SDL_DestroyTexture(texture); });
+  std::for_each(std::begin(star_textures_), std::end(star_textures_), [] (auto texture) { CountedDestroyTexture(texture); });
+  std::for_each(std::begin(explosion_texture_), std::end(explosion_texture_), [] (auto texture) { CountedDestroyTexture(texture); });
 }
@@ -2,11 +2,12 @@
 
 #include "constants.h"
 #include "audio.h"
+#include "draw_calls.h"
+#include "function_caller.h"
 #include "sprite.h"
 
 #include <string>
 #include <vector>
-#include <random>
 #include <memory>
 
 #include <SDL_ttf.h>
@@ -15,20 +16,14 @@ class AssetManagerInterface {
  public:
   virtual ~AssetManagerInterface() {}
 
-  virtual std::shared_ptr<const Sprite> GetSprite() const = 0;
-
-  virtual std::shared_ptr<const Sprite> GetSprite(int) const = 0;
-
   virtual std::shared_ptr<const Sprite> GetSprite(SpriteID) const = 0;
-
-  virtual void ResetPreviousIds() = 0;
 };
 
 enum Font { Normal, Bold, Small, Large };
 
 class AssetManager final : public AssetManagerInterface {
  public:
-  explicit AssetManager(SDL_Renderer *renderer);
+  AssetManager(SDL_Renderer *renderer, const AudioConfig& audio_config);
 
   AssetManager(const AssetManager&) = delete;
 
@@ -36,18 +31,6 @@ class AssetManager final : public AssetManagerInterface {
 
   virtual SDL_Texture *GetBackgroundTexture() const { return background_texture_.get(); }
 
-  virtual std::shared_ptr<const Sprite> GetSprite() const override { return sprites_.at(distribution_(engine_)); }
-
-  virtual std::shared_ptr<const Sprite> GetSprite(int col) const override {
-    SpriteID id;
-
-    do {
-      id = static_cast<SpriteID>(distribution_(engine_));
-    } while (previous_ids_.at(col) == id || (col < kCols - 1 && id == previous_ids_.at(col + 1)));
-    previous_ids_[col] = id;
-    return sprites_.at(id);
-  }
-
   virtual std::shared_ptr<const Sprite> GetSprite(SpriteID id) const override {
     if (id > SpriteID::Empty) {
       return sprites_[SpriteID::Empty];
@@ -63,13 +46,11 @@ class AssetManager final : public AssetManagerInterface {
 
   virtual TTF_Font *GetFont(int id) const { return fonts_[id].get(); }
 
-  virtual void ResetPreviousIds() override { previous_ids_ = std::vector<SpriteID>(kCols, SpriteID::Empty); }
-
   virtual const Audio& GetAudio() const { return audio_; }
 
  private:
   using UniqueFontPtr = std::unique_ptr<TTF_Font, function_caller<void(TTF_Font*), &TTF_CloseFont>>;
-  using UniqueTexturePtr = std::unique_ptr<SDL_Texture, function_caller<void(SDL_Texture*), &SDL_DestroyTexture>>;
+  using UniqueTexturePtr = std::unique_ptr<SDL_Texture, function_caller<void(SDL_Texture*), &CountedDestroyTexture>>;
 
   std::vector<UniqueFontPtr> fonts_;
   std::vector<std::shared_ptr<const Sprite>> sprites_;
@@ -77,7 +58,4 @@ class AssetManager final : public AssetManagerInterface {
   std::vector<SDL_Texture *> explosion_texture_;
   UniqueTexturePtr background_texture_;
   Audio audio_;
-  mutable std::vector<SpriteID> previous_ids_ = std::vector<SpriteID>(kCols, SpriteID::Empty);
-  mutable std::mt19937 engine_ {std::random_device{}()};
-  mutable std::uniform_int_distribution<int> distribution_{ 0, kNumSprites - 1 };
 };
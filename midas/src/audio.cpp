@@ -1,64 +1,158 @@
 #include "audio.h"
+#include "metrics.h"
+#include "sdl_mixer_sink.h"
+#include "offline_audio_sink.h"
+#include "startup_profiler.h"
 
 #include <iostream>
 #include <string>
 #include <tuple>
+#include <algorithm>
 
 namespace {
 
-const std::vector<std::pair<std::string, int>> kSoundEffects = {
-  { "diamond-land.wav", MIX_MAX_VOLUME / 4 },
-  { "explosion.wav", MIX_MAX_VOLUME },
-  { "move-successful.wav", MIX_MAX_VOLUME / 2 },
-  { "move-unsuccessful.wav", MIX_MAX_VOLUME / 2 },
-  { "removed-one-chain.wav", MIX_MAX_VOLUME },
-  { "removed-two-chains.wav", MIX_MAX_VOLUME },
-  { "removed-many-chains.wav", MIX_MAX_VOLUME },
-  { "threshold_reached.wav", MIX_MAX_VOLUME },
-  { "times-up.wav", MIX_MAX_VOLUME / 2 },
-  { "hint.wav", MIX_MAX_VOLUME },
-  { "high-score.wav", MIX_MAX_VOLUME },
-  { "hurryup.wav", MIX_MAX_VOLUME }
+enum Priority { Low, Normal, High };
+
+// File, volume and priority. A voice can only be pre-empted by an effect with
+// a higher priority.
+const std::vector<std::tuple<std::string, int, int>> kSoundEffects = {
+  { "diamond-land.wav", MIX_MAX_VOLUME / 4, Low },
+  { "explosion.wav", MIX_MAX_VOLUME, High },
+  { "move-successful.wav", MIX_MAX_VOLUME / 2, Normal },
+  { "move-unsuccessful.wav", MIX_MAX_VOLUME / 2, Normal },
+  { "removed-one-chain.wav", MIX_MAX_VOLUME, High },
+  { "removed-two-chains.wav", MIX_MAX_VOLUME, High },
+  { "removed-many-chains.wav", MIX_MAX_VOLUME, High },
+  { "threshold_reached.wav", MIX_MAX_VOLUME, High },
+  { "times-up.wav", MIX_MAX_VOLUME / 2, Normal },
+  { "hint.wav", MIX_MAX_VOLUME, Normal },
+  { "high-score.wav", MIX_MAX_VOLUME, High },
+  { "hurryup.wav", MIX_MAX_VOLUME, High }
 };
 
-const int kMixChannels = 16;
+const int kMixChannels = 8; // Also the maximum number of simultaneous voices
+const Uint32 kCoalesceWindowMs = 50;
+const int kMaxCoalesceGain = 2;
+
+// Chunks are loaded at up to twice their volume so a coalesced voice has room
+// to get louder, the channel volume brings a single instance back down. Only
+// effects below half volume get the whole boost. One at half volume or more
+// is capped at MIX_MAX_VOLUME, and one already at MIX_MAX_VOLUME does not get
+// louder at all.
+int ChunkVolume(int volume) { return std::min(volume * 2, MIX_MAX_VOLUME); }
+
+int VoiceVolume(int volume, int instances) {
+  const int gain = std::min(3 + instances, 4 * kMaxCoalesceGain);
+
+  return std::min((volume * MIX_MAX_VOLUME * gain) / (4 * ChunkVolume(volume)), MIX_MAX_VOLUME);
+}
+
 #if defined(__linux__)
 const std::string kAssetFolder = "assets/sfx/";
 #else
 const std::string kAssetFolder = "../../assets/sfx/";
 #endif
-}
 
-Audio::Audio() {
-  std::string full_path = kAssetFolder + "music-loop.wav";
+#if defined(MIDAS_BUILTIN_MUSIC_DECODER)
+const std::string kMusicFile = "music-loop-ima.wav";
+#else
+const std::string kMusicFile = "music-loop.wav";
+#endif
 
-  music_ = UniqueMusicPtr{ Mix_LoadMUS(full_path.c_str()) };
+}
 
-  if (nullptr == music_) {
-    std::cout << "Failed to load: " << full_path << ". Error: " << Mix_GetError() << std::endl;
-    exit(-1);
+std::unique_ptr<AudioSink> CreateAudioSink(const AudioConfig& config, int voices) {
+  switch (config.backend) {
+    case AudioBackend::Null:
+      return std::make_unique<NullAudioSink>();
+    case AudioBackend::Offline:
+      return std::make_unique<OfflineAudioSink>(config, voices);
+    default:
+      return std::make_unique<SdlMixerSink>(config, voices);
   }
-  Mix_AllocateChannels(kMixChannels);
-  Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
+}
 
-  for (auto effect_entry : kSoundEffects) {
-    auto [effect, volume] = effect_entry;
+Audio::Audio(const AudioConfig& config) {
+  StartupStage stage("Audio::Audio");
 
-    full_path = kAssetFolder + effect;
+  sink_ = CreateAudioSink(config, kMixChannels);
+  voices_.resize(kMixChannels);
 
-    auto chunk = UniqueChunkPtr{ Mix_LoadWAV(full_path.c_str()) };
+  if (!sink_->LoadMusic(kAssetFolder + kMusicFile, MIX_MAX_VOLUME / 3)) {
+    exit(-1);
+  }
+  for (size_t i = 0; i < kSoundEffects.size(); ++i) {
+    const auto& [file, volume, priority] = kSoundEffects[i];
 
-    if (nullptr == chunk) {
-      std::cout << "Failed to load: " << full_path << ". Error: " << Mix_GetError() << std::endl;
+    if (!sink_->LoadSound(static_cast<SoundEffect>(i), kAssetFolder + file, ChunkVolume(volume))) {
       exit(-1);
     }
-    Mix_VolumeChunk(chunk.get(), volume);
-    sound_effects_.push_back(std::move(chunk));
-
   }
 }
 
 Audio::~Audio() noexcept {
-  Mix_HaltMusic();
-  Mix_HaltChannel(-1);
+  StopMusic();
+  sink_->Halt(-1);
+}
+
+void Audio::PlaySound(SoundEffect effect, int time_in_ms) const {
+  const auto& [file, volume, priority] = kSoundEffects.at(effect);
+  const Uint32 now = sink_->GetTicks();
+  int free_voice = -1;
+  int victim = -1;
+  int active_voices = 0;
+
+  for (int v = 0; v < kMixChannels; ++v) {
+    auto& voice = voices_[v];
+
+    if (!sink_->IsPlaying(v)) {
+      voice = Voice();
+      free_voice = (free_voice == -1) ? v : free_voice;
+      continue;
+    }
+    active_voices++;
+    if (voice.effect == effect && now - voice.started <= kCoalesceWindowMs) {
+      voice.instances++;
+      sink_->SetVolume(v, VoiceVolume(volume, voice.instances));
+      statistics_.coalesced++;
+      return;
+    }
+    if (voice.priority < priority && (victim == -1 || voice.priority < voices_[victim].priority ||
+                                      (voice.priority == voices_[victim].priority && voice.started < voices_[victim].started))) {
+      victim = v;
+    }
+  }
+  if (free_voice == -1) {
+    if (victim == -1) {
+      statistics_.dropped++;
+      Metrics::Get().Add(Metric::SoundsDropped);
+      return;
+    }
+    sink_->Halt(victim);
+    statistics_.preempted++;
+    free_voice = victim;
+    active_voices--;
+  }
+  if (!sink_->Play(free_voice, effect, VoiceVolume(volume, 1), time_in_ms)) {
+    statistics_.dropped++;
+    Metrics::Get().Add(Metric::SoundsDropped);
+    return;
+  }
+  voices_[free_voice] = { effect, priority, now, 1 };
+  statistics_.played++;
+  Metrics::Get().Add(Metric::SoundsPlayed);
+  statistics_.peak_voices = std::max(statistics_.peak_voices, active_voices + 1);
+}
+
+void Audio::StopSound() const {
+  sink_->Halt(-1);
+  std::fill(voices_.begin(), voices_.end(), Voice());
+}
+
+AudioStatistics Audio::GetStatistics() const {
+  AudioStatistics statistics = statistics_;
+
+  sink_->GetStatistics(statistics);
+
+  return statistics;
 }
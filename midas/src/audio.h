@@ -1,53 +1,44 @@
 #pragma once
 
-#include "function_caller.h"
+#include "audio_sink.h"
 
 #include <vector>
 #include <memory>
 
-#include <SDL_mixer.h>
-
-enum SoundEffect {
-  DiamondLanding,
-  Explosion,
-  MoveSuccessful,
-  MoveUnSuccessful,
-  RemovedOneChain,
-  RemovedTwoChains,
-  RemovedManyChains,
-  ThresholdReached,
-  TimesUp,
-  Hint,
-  HighScore,
-  HurryUp
-};
-
 class Audio final {
  public:
-  Audio();
+  explicit Audio(const AudioConfig& config = AudioConfig());
 
   ~Audio() noexcept;
 
-  void PlayMusic() const {
-    Mix_HaltMusic();
-    Mix_RewindMusic();
-    Mix_FadeInMusic(music_.get(), -1, 500);
-  }
+  void PlayMusic() const { sink_->PlayMusic(500); }
 
-  void FadeoutMusic(int ms) const { Mix_FadeOutMusic(ms); }
+  void FadeoutMusic(int ms) const { sink_->FadeoutMusic(ms); }
 
-  void StopMusic() const {  Mix_HaltMusic(); }
+  void StopMusic() const { sink_->StopMusic(); }
 
-  void PlaySound(SoundEffect effect, int time_in_ms = -1) const {
-    Mix_PlayChannelTimed(-1, sound_effects_.at(effect).get(), 0, time_in_ms);
-  }
+  // Duplicates of an effect started within a short window are folded into the
+  // voice already playing it. The voice gets louder instead, as far as the
+  // effect's volume leaves room. When every voice is busy the effect
+  // pre-empts a lower priority voice or is dropped.
+  void PlaySound(SoundEffect effect, int time_in_ms = -1) const;
 
-  void StopSound() const { Mix_HaltChannel(-1); }
+  void StopSound() const;
 
- private:
-  using UniqueMusicPtr = std::unique_ptr<Mix_Music, function_caller<void(Mix_Music*), &Mix_FreeMusic>>;
-  using UniqueChunkPtr = std::unique_ptr<Mix_Chunk, function_caller<void(Mix_Chunk*), &Mix_FreeChunk>>;
+  void AdvanceTime(double seconds) const { sink_->AdvanceTime(seconds); }
 
-  UniqueMusicPtr music_;
-  std::vector<UniqueChunkPtr> sound_effects_;
+  // Latency figures are only collected when AudioConfig::measure_latency is set
+  AudioStatistics GetStatistics() const;
+
+ private:
+  struct Voice {
+    int effect = -1;
+    int priority = 0;
+    Uint32 started = 0;
+    int instances = 0;
+  };
+
+  std::unique_ptr<AudioSink> sink_;
+  mutable std::vector<Voice> voices_;
+  mutable AudioStatistics statistics_;
 };
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <SDL_mixer.h>
+
+enum SoundEffect {
+  DiamondLanding,
+  Explosion,
+  MoveSuccessful,
+  MoveUnSuccessful,
+  RemovedOneChain,
+  RemovedTwoChains,
+  RemovedManyChains,
+  ThresholdReached,
+  TimesUp,
+  Hint,
+  HighScore,
+  HurryUp
+};
+
+enum class AudioBackend { SdlMixer, Null, Offline };
+
+struct AudioConfig {
+  AudioBackend backend = AudioBackend::SdlMixer;
+  int frequency = MIX_DEFAULT_FREQUENCY;
+  int channels = MIX_DEFAULT_CHANNELS;
+  int buffer_size = 512; // Sample frames per mixer callback
+  bool measure_latency = false;
+  std::string output_file = "midas-audio.wav"; // Used by the offline backend
+};
+
+struct AudioStatistics {
+  int played = 0;
+  int coalesced = 0;
+  int preempted = 0;
+  int dropped = 0;
+  int peak_voices = 0;
+  double mixer_load = 0.0;
+  int latency_samples = 0;
+  double average_latency_ms = 0.0;
+  double max_latency_ms = 0.0;
+};
+
+// The output Audio plays through. Voices are numbered 0 to the number given
+// to CreateAudioSink, the voice allocation itself is done by Audio.
+class AudioSink {
+ public:
+  virtual ~AudioSink() {}
+
+  virtual bool LoadMusic(const std::string& path, int volume) = 0;
+
+  virtual bool LoadSound(SoundEffect effect, const std::string& path, int volume) = 0;
+
+  virtual bool Play(int voice, SoundEffect effect, int volume, int time_in_ms) = 0;
+
+  virtual bool IsPlaying(int voice) const = 0;
+
+  virtual void SetVolume(int voice, int volume) = 0;
+
+  // Halts all voices when voice is -1
+  virtual void Halt(int voice) = 0;
+
+  virtual void PlayMusic(int fade_in_ms) = 0;
+
+  virtual void FadeoutMusic(int ms) = 0;
+
+  virtual void StopMusic() = 0;
+
+  // Game time in milliseconds, used to coalesce sound effects
+  virtual Uint32 GetTicks() const { return SDL_GetTicks(); }
+
+  // Called once per frame with the frame time, only needed by sinks that
+  // are not driven by an audio device
+  virtual void AdvanceTime(double) {}
+
+  virtual void GetStatistics(AudioStatistics&) const {}
+};
+
+class NullAudioSink final : public AudioSink {
+ public:
+  virtual bool LoadMusic(const std::string&, int) override { return true; }
+
+  virtual bool LoadSound(SoundEffect, const std::string&, int) override { return true; }
+
+  virtual bool Play(int, SoundEffect, int, int) override { return true; }
+
+  virtual bool IsPlaying(int) const override { return false; }
+
+  virtual void SetVolume(int, int) override {}
+
+  virtual void Halt(int) override {}
+
+  virtual void PlayMusic(int) override {}
+
+  virtual void FadeoutMusic(int) override {}
+
+  virtual void StopMusic() override {}
+
+  virtual Uint32 GetTicks() const override { return 0; }
+};
+
+std::unique_ptr<AudioSink> CreateAudioSink(const AudioConfig& config, int voices);
@@ -0,0 +1,141 @@
+#include "autoplay.h"
+#include "headless_asset_manager.h"
+
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+
+namespace {
+
+const int kRolloutsPerMove = 4; // For every candidate move in every round of the search
+
+const Element& EmptyElement() {
+  static const Element empty(SpriteID::Empty);
+
+  return empty;
+}
+
+// Swaps the pieces, scores and removes the matches and resolves every cascade
+void PlayMove(Grid& grid, ScoreRules& score, const Position& p1, const Position& p2) {
+  auto [matches, chains] = grid.GetMatchesFromSwap(p1, p2);
+
+  if (matches.empty()) {
+    return;
+  }
+  std::swap(grid.At(p1), grid.At(p2));
+  score.Update(std::set<Position>(matches.begin(), matches.end()).size(), chains);
+  for (const auto& p : matches) {
+    grid.At(p) = EmptyElement();
+  }
+  grid.ResolveCascades(score);
+}
+
+int Percentile(const std::vector<int>& sorted, double p) {
+  return sorted.at(static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+}
+
+}
+
+MonteCarloPlayer::MonteCarloPlayer(const AutoplayConfig& config, uint64_t seed)
+    : config_(config), pool_(config.threads), seed_(seed) {}
+
+std::optional<MoveEvaluation> MonteCarloPlayer::ChooseMove(const Grid& grid, const ScoreRules& score) {
+  const auto moves = grid.EnumerateMoves();
+
+  if (moves.size() <= 1) {
+    return moves.empty() ? std::nullopt : std::make_optional(moves.front());
+  }
+  const auto start = std::chrono::steady_clock::now();
+  const int tasks = static_cast<int>(moves.size()) * kRolloutsPerMove;
+  std::vector<int> points(tasks);
+  std::vector<int64_t> totals(moves.size());
+
+  // Whole rounds, so every move has been tried the same number of times
+  do {
+    const uint64_t seed = seed_;
+
+    pool_.Run(tasks, [&](int task, int) {
+      points[task] = Rollout(grid, score, moves[task % moves.size()], seed + task);
+    });
+    seed_ += tasks;
+    for (int task = 0; task < tasks; ++task) {
+      totals[task % moves.size()] += points[task];
+    }
+    statistics_.rollouts += tasks;
+  } while (std::chrono::steady_clock::now() - start < config_.budget);
+
+  statistics_.steals = pool_.GetSteals();
+  statistics_.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return moves[std::distance(totals.begin(), std::max_element(totals.begin(), totals.end()))];
+}
+
+int MonteCarloPlayer::Rollout(Grid grid, ScoreRules score, const MoveEvaluation& move, uint64_t seed) const {
+  const int start = score.Get();
+  std::mt19937 engine(static_cast<uint32_t>(seed));
+  const auto mode = (config_.policy == RolloutPolicy::Greedy) ? HintMode::Best : HintMode::Random;
+
+  grid.Reseed(seed);
+  PlayMove(grid, score, move.p1, move.p2);
+  for (int depth = 1; depth < config_.depth; ++depth) {
+    auto next = ChooseHint(grid.EnumerateMoves(), mode, engine);
+
+    if (!next) {
+      break;
+    }
+    PlayMove(grid, score, next->p1, next->p2);
+  }
+  return score.Get() - start;
+}
+
+std::optional<MoveEvaluation> Autoplayer::Poll(const Grid& grid, const ScoreRules& score, uint64_t version) {
+  if (!search_.valid()) {
+    searched_version_ = version;
+    search_ = std::async(std::launch::async, [this, grid, score] { return player_.ChooseMove(grid, score); });
+  }
+  if (search_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return std::nullopt;
+  }
+  auto move = search_.get();
+
+  // The board changed while the search ran, the next call searches it
+  if (searched_version_ != version) {
+    return std::nullopt;
+  }
+  return move;
+}
+
+void RunHeadlessGames(const AutoplayConfig& config, int games, int moves) {
+  MonteCarloPlayer player(config, 1);
+  HeadlessAssetManager asset_manager;
+  std::vector<int> scores;
+
+  for (int game = 0; game < games; ++game) {
+    Grid grid(kRows, kCols, &asset_manager, game + 1);
+    ScoreRules score;
+
+    grid.ResolveCascades(score);
+    for (int move = 0; move < moves; ++move) {
+      auto next = player.ChooseMove(grid, score);
+
+      if (!next) {
+        break;
+      }
+      PlayMove(grid, score, next->p1, next->p2);
+    }
+    scores.push_back(score.Get());
+    std::cout << "Game " << game + 1 << ": " << score.Get() << std::endl;
+  }
+  std::sort(scores.begin(), scores.end());
+
+  const double mean = std::accumulate(scores.begin(), scores.end(), 0.0) / scores.size();
+  const double variance = std::accumulate(scores.begin(), scores.end(), 0.0, [mean](double sum, int s) { return sum + (s - mean) * (s - mean); }) / scores.size();
+  const auto& statistics = player.GetStatistics();
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "Score over " << games << " games of " << moves << " moves: mean " << mean << " stddev " << std::sqrt(variance)
+            << " min " << scores.front() << " p10 " << Percentile(scores, 0.1) << " median " << Percentile(scores, 0.5)
+            << " p90 " << Percentile(scores, 0.9) << " max " << scores.back() << std::endl;
+  std::cout << "Rollouts: " << statistics.rollouts << " in " << statistics.seconds << " s, " << statistics.RolloutsPerSecond()
+            << " rollouts/s on " << config.threads << " threads, " << statistics.steals << " tasks stolen" << std::endl;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "grid.h"
+#include "hint.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <future>
+#include <optional>
+
+enum class RolloutPolicy { Random, Greedy };
+
+struct AutoplayConfig {
+  int threads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+  std::chrono::milliseconds budget { 100 }; // Search time per move
+  int depth = 3; // Moves per rollout, the candidate move included
+  RolloutPolicy policy = RolloutPolicy::Greedy;
+};
+
+struct AutoplayStatistics {
+  uint64_t rollouts = 0;
+  uint64_t steals = 0;
+  double seconds = 0.0;
+
+  double RolloutsPerSecond() const { return (seconds > 0.0) ? rollouts / seconds : 0.0; }
+};
+
+// Picks moves by playing rollouts from every candidate move on copies of the
+// grid, in parallel, and taking the move with the best average score. The
+// copies get refills of their own so the player does not know which pieces
+// the game will drop.
+class MonteCarloPlayer final {
+ public:
+  MonteCarloPlayer(const AutoplayConfig& config, uint64_t seed);
+
+  MonteCarloPlayer(const MonteCarloPlayer&) = delete;
+
+  std::optional<MoveEvaluation> ChooseMove(const Grid& grid, const ScoreRules& score);
+
+  const AutoplayStatistics& GetStatistics() const { return statistics_; }
+
+ protected:
+  // Returns the points scored by the move and the rest of the rollout
+  int Rollout(Grid grid, ScoreRules score, const MoveEvaluation& move, uint64_t seed) const;
+
+ private:
+  AutoplayConfig config_;
+  WorkStealingPool pool_;
+  uint64_t seed_;
+  AutoplayStatistics statistics_;
+};
+
+// Lets the player drive the game. The search runs on a copy of the grid in
+// the background so the game keeps rendering while it thinks. Every search
+// carries the version of the board it was started for, like BoardAnalyzer,
+// and a move found for a board that has changed since is dropped.
+class Autoplayer final {
+ public:
+  explicit Autoplayer(const AutoplayConfig& config) : player_(config, std::random_device{}()) {}
+
+  ~Autoplayer() { Stop(); }
+
+  // Waits for a search that is still running, it writes the statistics
+  void Stop() {
+    if (search_.valid()) {
+      search_.wait();
+    }
+  }
+
+  // Call it when the board is settled, it starts a search and returns the
+  // move once the search of this version is done
+  std::optional<MoveEvaluation> Poll(const Grid& grid, const ScoreRules& score, uint64_t version);
+
+  // Only call it when no search runs, e.g. after Stop
+  const AutoplayStatistics& GetStatistics() const { return player_.GetStatistics(); }
+
+ private:
+  MonteCarloPlayer player_;
+  std::future<std::optional<MoveEvaluation>> search_;
+  uint64_t searched_version_ = 0;
+};
+
+// Plays games of a fixed number of moves without SDL and prints the score
+// distribution and the rollout rate
+void RunHeadlessGames(const AutoplayConfig& config, int games, int moves);
@@ -1,8 +1,9 @@
 #include "board.h"
 #include "score.h"
+#include "startup_profiler.h"
+#include "trace.h"
 
-#include <sstream>
-#include <iomanip>
+#include <cstdio>
 
 namespace {
 
@@ -48,26 +49,39 @@ bool CanUpdateBoard(const std::deque<std::shared_ptr<Animation>>& animations) {
   return animations.empty() || (c == 0);
 }
 
+// Short enough for the small string optimization, so no allocation
 std::string FormatTime(size_t seconds) {
-  std::stringstream ss;
+  char text[16];
 
-  int minutes = static_cast<int>(seconds / 60.0);
+  std::snprintf(text, sizeof(text), "%02d:%02d", static_cast<int>(seconds / 60), static_cast<int>(seconds % 60));
 
-  ss << std::setfill('0') << std::setw(2) << minutes << ":" << std::setfill('0') << std::setw(2) << seconds % 60;
-
-  return ss.str();
+  return text;
 }
 
 }
 
-Board::Board() {
-  window_ = SDL_CreateWindow("Yet Another Midas Clone", SDL_WINDOWPOS_UNDEFINED,
-                             SDL_WINDOWPOS_UNDEFINED, kWidth, kHeight, SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+// The benchmark analyses on the frame so its frames do not depend on thread timing
+Board::Board(const Options& options)
+    : seed_(options.seed), show_metrics_(options.metrics_overlay),
+      analyzer_(options.hint, std::random_device{}(), options.benchmark_frames < 0) {
+  {
+    StartupStage stage("SDL_CreateWindow");
+
+    window_ = SDL_CreateWindow("Yet Another Midas Clone", SDL_WINDOWPOS_UNDEFINED,
+                               SDL_WINDOWPOS_UNDEFINED, kWidth, kHeight, SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+  }
   if (nullptr == window_) {
     std::cout << "Failed to create window : " << SDL_GetError() << std::endl;
     exit(-1);
   }
-  renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED);
+  if (options.benchmark_frames >= 0) {
+    SDL_SetHint(SDL_HINT_RENDER_VSYNC, "0");
+  }
+  {
+    StartupStage stage("SDL_CreateRenderer");
+
+    renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED);
+  }
   if (nullptr == renderer_) {
     std::cout << "Failed to create renderer : " << SDL_GetError() << std::endl;
     exit(-1);
@@ -75,12 +89,16 @@ Board::Board() {
   SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
   SDL_RenderSetLogicalSize(renderer_, kWidth, kHeight);
 
-  asset_manager_ = std::make_shared<AssetManager>(renderer_);
+  asset_manager_ = std::make_shared<AssetManager>(renderer_, options.audio);
 
+  timers_.SetTimeScale(options.time_scale);
   Restart();
+  board_pool_ = std::make_unique<BoardPool>(options.board_pool, [this] { return NewGrid(); });
+  score_timer_ = timers_.Every(std::chrono::milliseconds(kScoreStepMs), [this] { score_.StepDisplayedScore(); });
 }
 
 Board::~Board() noexcept {
+  board_pool_.reset();
   SDL_DestroyRenderer(renderer_);
   SDL_DestroyWindow(window_);
 }
@@ -91,24 +109,117 @@ void Board::Restart(bool music_on) {
   active_animations_.clear();
   queued_animations_.clear();
   first_selected_ = kNothingSelected;
-  grid_ = std::make_unique<Grid>(kRows, kCols, asset_manager_.get());
-  timer_animation_ = std::make_shared<TimerAnimation>(renderer_, *grid_.get(), asset_manager_);
+  // The animations hold on to the grid, it is replaced in place
+  if (grid_) {
+    *grid_ = std::move(*TakeGrid());
+    timer_animation_->Reset();
+  } else {
+    grid_ = NewGrid();
+    timer_animation_ = std::make_shared<TimerAnimation>(renderer_, *grid_.get(), asset_manager_, timers_);
+  }
+  history_.Clear();
+  record_move_ = true;
+  BoardChanged();
   asset_manager_->GetAudio().StopSound();
   if (music_on) {
     asset_manager_->GetAudio().PlayMusic();
   }
 }
 
+std::unique_ptr<Grid> Board::NewGrid() const {
+  if (seed_ > 0) {
+    return std::make_unique<Grid>(kRows, kCols, asset_manager_.get(), seed_);
+  }
+  return std::make_unique<Grid>(kRows, kCols, asset_manager_.get());
+}
+
+std::unique_ptr<Grid> Board::TakeGrid() {
+  auto grid = board_pool_->Take();
+
+  return grid ? std::move(grid) : NewGrid();
+}
+
 std::shared_ptr<Animation> Board::ShowHint() {
   if (timer_animation_->IsReady()) {
     return nullptr;
   }
-  if (auto [matches_found, match_pos] = grid_->FindPotentialMatches(); matches_found) {
-    return std::make_shared<HintAnimation>(renderer_, *grid_, match_pos.first, match_pos.second, asset_manager_);
+  if (auto analysis = analyzer_.Poll(version_); analysis) {
+    if (analysis->hint) {
+      return std::make_shared<HintAnimation>(renderer_, *grid_, analysis->hint->p1, analysis->hint->p2, asset_manager_);
+    }
+    return nullptr;
   }
+  show_hint_ = true;
+
   return nullptr;
 }
 
+bool Board::IsIdle() const {
+  return !game_over_ && !timer_animation_->IsReady() && CanUpdateBoard(active_animations_) &&
+    queued_animations_.empty() && grid_->IsSettled();
+}
+
+void Board::Snapshot(GameSnapshot& snapshot) const {
+  grid_->Snapshot(snapshot.grid);
+  snapshot.score = score_.GetRules();
+  snapshot.elapsed_time = timer_animation_->GetElapsedTime();
+}
+
+void Board::Restore(const GameSnapshot& snapshot) {
+  active_animations_.clear();
+  queued_animations_.clear();
+  first_selected_ = kNothingSelected;
+  grid_->Restore(snapshot.grid);
+  BoardChanged();
+  score_.Restore(snapshot.score);
+  timer_animation_->SetElapsedTime(snapshot.elapsed_time);
+}
+
+bool Board::Rewind(int moves) {
+  GameSnapshot snapshot;
+
+  if (!IsIdle() || !history_.Rewind(moves, snapshot)) {
+    return false;
+  }
+  snapshot.elapsed_time = timer_animation_->GetElapsedTime();
+  Restore(snapshot);
+
+  return true;
+}
+
+void Board::RecordMove() {
+  if (record_move_ && IsIdle()) {
+    GameSnapshot snapshot;
+
+    Snapshot(snapshot);
+    history_.Record(snapshot);
+    record_move_ = false;
+  }
+}
+
+void Board::AnalyseBoard() {
+  if (!IsIdle()) {
+    return;
+  }
+  analyzer_.Request(*grid_, version_);
+  if (auto analysis = analyzer_.Poll(version_); analysis) {
+    if (analysis->dead) {
+      // A seeded game makes its next board from its own stream, so it stays
+      // the same game
+      if (seed_ > 0) {
+        grid_->ReplaceDeadBoard();
+      } else {
+        grid_->ReplaceDeadBoard(*TakeGrid());
+      }
+      std::cout << "No solutions found, creating a new board" << std::endl;
+      BoardChanged();
+    } else if (show_hint_ && analysis->hint) {
+      queued_animations_.push_back(std::make_shared<HintAnimation>(renderer_, *grid_, analysis->hint->p1, analysis->hint->p2, asset_manager_));
+      show_hint_ = false;
+    }
+  }
+}
+
 void Board::DecreseScore() {
     if (timer_animation_->IsReady()) {
       return;
@@ -119,13 +230,31 @@ void Board::DecreseScore() {
     score_.Decrese();
   }
 
+void Board::ResetIdleTimers() {
+  idle_penalty_timer_ = timers_.Every(std::chrono::seconds(kIdlePenaltyTimer), [this] { DecreseScore(); });
+  show_hint_timer_ = timers_.Every(std::chrono::seconds(kShowHintTimer), [this] {
+    if (auto hint = ShowHint(); hint) {
+      queued_animations_.push_back(hint);
+    }
+  });
+}
+
 void Board::BoardNotIdle() {
   RemoveIdleAnimations(active_animations_);
   RemoveIdleAnimations(queued_animations_);
 }
 
-std::vector<std::shared_ptr<Animation>> Board::ButtonPressed(const Position& p) {
-  std::vector<std::shared_ptr<Animation>> animations;
+void Board::ClearSelection() {
+  if (!(kNothingSelected == first_selected_)) {
+    grid_->At(first_selected_).Unselect();
+    first_selected_ = kNothingSelected;
+  }
+}
+
+Animations Board::ButtonPressed(const Position& p) {
+  TRACE_ZONE("Board::ButtonPressed");
+
+  Animations animations(GetFrameArena());
 
   if (timer_animation_->IsReady() || !p.IsValid() || grid_->IsFilling()) {
     return animations;
@@ -139,10 +268,12 @@ std::vector<std::shared_ptr<Animation>> Board::ButtonPressed(const Position& p)
     if (IsSwapValid(first_selected_, selected)) {
       auto [matches, chains] = grid_->GetMatchesFromSwap(first_selected_, selected);
 
+      BoardChanged();
       animations.emplace_back(std::make_shared<SwapAnimation>(renderer_, *grid_, first_selected_, selected, !matches.empty(), asset_manager_));
 
       if (!matches.empty()) {
         score_.Update(matches, chains);
+        record_move_ = true;
         animations.emplace_back(std::make_shared<MatchAnimation>(renderer_, *grid_, matches, chains, asset_manager_));
       }
     } else {
@@ -153,13 +284,16 @@ std::vector<std::shared_ptr<Animation>> Board::ButtonPressed(const Position& p)
   return animations;
 }
 
-void Board::Render(const std::vector<std::shared_ptr<Animation>>& animations, double delta_time) {
+void Board::Render(Animations& animations, double delta_time) {
+  TRACE_ZONE("Board::Render");
+
   if (set_window_size_) {
     SDL_SetWindowSize(window_, kWidth, kHeight);
     set_window_size_ = false;
   }
+  timers_.Advance(ToDuration(delta_time));
   SDL_RenderClear(renderer_);
-  SDL_RenderCopy(renderer_, asset_manager_->GetBackgroundTexture(), nullptr, nullptr);
+  CountedRenderCopy(renderer_, asset_manager_->GetBackgroundTexture(), nullptr, nullptr);
 
   if (timer_animation_->IsReady()) {
     if (!game_over_) {
@@ -169,7 +303,7 @@ void Board::Render(const std::vector<std::shared_ptr<Animation>>& animations, do
       game_over_ = true;
     }
     if (active_animations_.size() == 0) {
-      ActivateAnimation<ExplosionAnimation>(renderer_, *grid_, asset_manager_);
+      ActivateAnimation<ExplosionAnimation>(renderer_, *grid_, asset_manager_, timers_);
     }
     RenderText(400, 233, Font::Bold, "G A M E  O V E R", Color::Red);
     RunAnimation(active_animations_, delta_time);
@@ -178,7 +312,7 @@ void Board::Render(const std::vector<std::shared_ptr<Animation>>& animations, do
 
     SDL_RenderSetClipRect(renderer_, &kClipRect);
 
-    std::copy(animations.begin(), animations.end(), std::back_inserter(queued_animations_));
+    std::move(animations.begin(), animations.end(), std::back_inserter(queued_animations_));
 
     if (CanUpdateBoard(active_animations_) && !queued_animations_.empty()) {
       auto animation = queued_animations_.front();
@@ -189,35 +323,71 @@ void Board::Render(const std::vector<std::shared_ptr<Animation>>& animations, do
     if (score_.ThresholdReached()) {
       // This animation does not lock the board so we can add it directly to the
       // active animation queue
-      ActivateAnimation<ThresholdReachedAnimation>(renderer_, *grid_, asset_manager_, score_.GetTotalMatches());
+      ActivateAnimation<ThresholdReachedAnimation>(renderer_, *grid_, asset_manager_, timers_, score_.GetTotalMatches());
     }
     RunAnimation(active_animations_, delta_time);
 
     if (CanUpdateBoard(active_animations_) && CanUpdateBoard(queued_animations_)) {
-      auto [moved_objects, matches, chains] = grid_->Collaps(score_.GetConsecutiveMatchesRef(),
-                                                                score_.GetPreviousConsecutiveMatchesRef());
+      const int chains = grid_->Collaps(score_.GetConsecutiveMatchesRef(), score_.GetPreviousConsecutiveMatchesRef(),
+                                        moved_objects_, matches_, false);
 
-      score_.Update(matches, chains);
+      if (!moved_objects_.empty() || !matches_.empty()) {
+        BoardChanged();
+      }
+      // The refills popped, generate the next ones before they are needed
+      if (!moved_objects_.empty() && !top_up_posted_) {
+        top_up_posted_ = true;
+        idle_scheduler_.Post([this](IdleScheduler::Clock::time_point) {
+          grid_->TopUpRefills();
+          top_up_posted_ = false;
+          return false;
+        });
+      }
+      score_.Update(matches_, chains);
 
-      if (!matches.empty()) {
-        ActivateAnimation<MatchAnimation>(renderer_, *grid_, matches, chains, asset_manager_);
+      if (!matches_.empty()) {
+        ActivateAnimation<MatchAnimation>(renderer_, *grid_, matches_, chains, asset_manager_);
       }
-      for (const auto& obj:moved_objects) {
+      for (const auto& obj:moved_objects_) {
         ActivateAnimation<MoveDownAnimation>(renderer_, *grid_, obj, asset_manager_);
       }
     }
     timer_animation_->Update(delta_time);
+    AnalyseBoard();
+    RecordMove();
     SDL_RenderSetClipRect(renderer_, nullptr);
+    if (timers_.IsPaused()) {
+      RenderText(430, 233, Font::Bold, "P A U S E D", Color::White);
+    }
+  }
+  UpdateStatus(10, 1);
+  if (show_metrics_) {
+    RenderMetrics();
+  }
+  {
+    StartupStage stage("First SDL_RenderPresent");
+
+    SDL_RenderPresent(renderer_);
   }
-  UpdateStatus(delta_time, 10, 1);
-  SDL_RenderPresent(renderer_);
+  Metrics::Get().Set(Metric::ActiveAnimations, active_animations_.size());
+  Metrics::Get().Set(Metric::QueuedAnimations, queued_animations_.size());
+  Metrics::Get().EndFrame();
+  asset_manager_->GetAudio().AdvanceTime(delta_time);
+  animations.clear();
+  GetFrameArena().Reset();
 }
 
-void Board::UpdateStatus(double delta, int x, int y) {
+void Board::RunIdleJobs(IdleScheduler::Clock::time_point deadline) {
+  const auto used = idle_scheduler_.Run(deadline);
+
+  Metrics::Get().Set(Metric::IdleWorkUs, std::chrono::duration_cast<std::chrono::microseconds>(used).count());
+}
+
+void Board::UpdateStatus(int x, int y) {
   if (score_.NewHighScore()) {
     asset_manager_->GetAudio().PlaySound(HighScore);
   }
-  auto [score, highscore] = score_.GetDisplayedScore(delta);
+  auto [score, highscore] = score_.GetDisplayedScore();
 
   RenderText(x, y, Font::Normal, "Score:", Color::White);
   RenderText(x + 74, y, Font::Normal, std::to_string(score), score_.GetColor());
@@ -225,3 +395,15 @@ void Board::UpdateStatus(double delta, int x, int y) {
   RenderText(x + 650, y, Font::Normal, std::to_string(highscore), Color::White);
   RenderText(x + 72, y + 430, Font::Bold, FormatTime(timer_animation_->GetTimeLeft()), Color::Blue);
 }
+
+// Shows the last frame, the overlay's own text adds to the draw calls,
+// textures and allocations of the next one
+void Board::RenderMetrics() const {
+  const auto& metrics = Metrics::Get();
+
+  for (int i = 0; i < kMetrics; ++i) {
+    const auto metric = static_cast<Metric>(i);
+
+    RenderText(10, 40 + i * 18, Font::Small, std::string(Metrics::GetName(metric)) + ": " + std::to_string(metrics.GetLastFrame(metric)), Color::Yellow);
+  }
+}
@@ -1,13 +1,18 @@
 #pragma once
 
 #include "animation.h"
+#include "board_analyzer.h"
+#include "board_pool.h"
+#include "options.h"
+#include "history.h"
+#include "idle_scheduler.h"
 
 #include <memory>
 #include <deque>
 
 class Board final {
  public:
-  Board();
+  explicit Board(const Options& options);
   Board(const Board&) = delete;
   Board(const Board&&) = delete;
   ~Board() noexcept;
@@ -18,20 +23,70 @@ class Board final {
 
   bool IsGameOver() const { return game_over_; }
 
+  // True when the game is running and no piece is moving or about to
+  bool IsIdle() const;
+
+  // Only take a snapshot of an idle board, while animations run the grid
+  // holds pieces that are owned by them
+  void Snapshot(GameSnapshot& snapshot) const;
+
+  void Restore(const GameSnapshot& snapshot);
+
+  // Takes back the last moves, the score included but not the time. Only
+  // possible when the board is idle.
+  bool Rewind(int moves);
+
+  // The hint for the board, or nullptr while it is worked out in the
+  // background, Render then starts it once it is known
   std::shared_ptr<Animation> ShowHint();
 
   void DecreseScore();
 
+  // Starts the hint and idle penalty timers over, after a move or a restart
+  void ResetIdleTimers();
+
+  // Stops the game time, the animations and the countdown with it
+  void SetPaused(bool paused) { timers_.SetPaused(paused); }
+
+  bool IsPaused() const { return timers_.IsPaused(); }
+
+  // The game time that passes in the real time, scaled by --time-scale
+  double GetGameDelta(TimerWheel::Clock::duration real) const {
+    return std::chrono::duration<double>(timers_.Scale(real)).count();
+  }
+
   void BoardNotIdle();
 
-  std::vector<std::shared_ptr<Animation>> ButtonPressed(const Position& p);
+  // Drops a piece the player has selected, e.g. before the autoplayer swaps
+  void ClearSelection();
+
+  // Changes with every move, restart and new board
+  uint64_t GetVersion() const { return version_; }
+
+  Animations ButtonPressed(const Position& p);
+
+  // Takes over the animations and leaves the vector empty, its storage is
+  // in the frame arena that is reset once the frame is presented. The game
+  // time moves on by the delta first, the timers that are due run then.
+  void Render(Animations& animations, double delta_timer);
 
-  void Render(const std::vector<std::shared_ptr<Animation>>&, double delta_timer);
+  void ToggleMetrics() { show_metrics_ = !show_metrics_; }
+
+  // Gives the idle jobs, e.g. topping up the refills, the time until the deadline
+  void RunIdleJobs(IdleScheduler::Clock::time_point deadline);
+
+  const IdleScheduler::Statistics& GetIdleStatistics() const { return idle_scheduler_.GetStatistics(); }
 
   const Element& operator()(int row, int col) const { return grid_->At(row, col); }
 
   const AssetManager& GetAsset() const { return *asset_manager_; }
 
+  const Grid& GetGrid() const { return *grid_; }
+
+  const ScoreRules& GetScore() const { return score_.GetRules(); }
+
+  BoardPool::Statistics GetBoardPoolStatistics() const { return board_pool_->GetStatistics(); }
+
  protected:
   template<class T, class ...Args>
   void ActivateAnimation(Args&&... args) {
@@ -41,13 +96,31 @@ class Board final {
     active_animations_.push_front(animation);
   }
 
-  void UpdateStatus(double delta, int x, int y);
+  void UpdateStatus(int x, int y);
+
+  void RecordMove();
+
+  std::unique_ptr<Grid> NewGrid() const;
+
+  // A board from the pool, or a new one when the pool has run dry
+  std::unique_ptr<Grid> TakeGrid();
+
+  // Asks for the analysis of an idle board and acts on it once it is done
+  void AnalyseBoard();
+
+  void BoardChanged() {
+    version_++;
+    show_hint_ = false;
+  }
+
+  void RenderMetrics() const;
 
   void RenderText(int x, int y, Font font, const std::string& text, Color text_color) const {
     ::RenderText(renderer_, x, y, asset_manager_->GetFont(font), text, text_color);
   }
 
  private:
+  TimerWheel timers_; // First, so it outlives everything holding a timer
   ScoreManagement score_;
   bool game_over_ = false;
   Position first_selected_;
@@ -57,6 +130,21 @@ class Board final {
   SDL_Renderer *renderer_ = nullptr;
   std::deque<std::shared_ptr<Animation>> queued_animations_;
   std::deque<std::shared_ptr<Animation>> active_animations_;
+  std::vector<Position> moved_objects_; // From the last Collaps, kept for their capacity
+  std::vector<Position> matches_;
   std::shared_ptr<TimerAnimation> timer_animation_;
   bool set_window_size_ = true;
+  GameHistory history_;
+  bool record_move_ = false;
+  int seed_;
+  bool show_metrics_;
+  BoardAnalyzer analyzer_;
+  uint64_t version_ = 1; // Changes with every move, restart and new board
+  bool show_hint_ = false; // Waiting for the analysis to start the hint
+  IdleScheduler idle_scheduler_ { std::chrono::microseconds(kIdleQuantumUs) };
+  bool top_up_posted_ = false;
+  std::unique_ptr<BoardPool> board_pool_; // Made after the first board, it uses the assets
+  TimerWheel::Timer score_timer_;
+  TimerWheel::Timer show_hint_timer_;
+  TimerWheel::Timer idle_penalty_timer_;
 };
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "grid.h"
+#include "hint.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+struct BoardAnalysis {
+  uint64_t version; // Of the board that was analysed
+  std::optional<MoveEvaluation> hint;
+  bool dead; // No move makes a match, the board has to be replaced
+};
+
+// Finds the hint for a board and whether it is dead on a copy of the grid
+// in the background, so neither the moves nor the hint choice is paid for
+// on a frame. Every request carries the version of the board it was made
+// for and a result is only given out for the version asked about, one for
+// a board that has changed since is dropped. One worker thread lives as long
+// as the analyzer and there is one slot for the next request and one for
+// the last result, a newer request replaces one that has not started.
+class BoardAnalyzer final {
+ public:
+  // A synchronous analyzer does the work in Request, for runs that must not
+  // depend on thread timing
+  BoardAnalyzer(HintMode mode, uint32_t seed, bool asynchronous = true)
+      : mode_(mode), engine_(seed), asynchronous_(asynchronous) {
+    if (asynchronous_) {
+      worker_ = std::thread([this] { Work(); });
+    }
+  }
+
+  BoardAnalyzer(const BoardAnalyzer&) = delete;
+
+  ~BoardAnalyzer() {
+    if (worker_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_up_.notify_one();
+      worker_.join();
+    }
+  }
+
+  // Queues the grid for analysis unless this version already is
+  void Request(const Grid& grid, uint64_t version) {
+    if (requested_ == version) {
+      return;
+    }
+    requested_ = version;
+    if (!asynchronous_) {
+      result_ = Analyse(grid, version);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // Copied into the grid of the slot, which keeps its storage
+      if (request_) {
+        *request_ = grid;
+      } else {
+        request_.emplace(grid);
+      }
+      request_version_ = version;
+      has_request_ = true;
+    }
+    wake_up_.notify_one();
+  }
+
+  // The analysis of the version once it is done
+  std::optional<BoardAnalysis> Poll(uint64_t version) {
+    if (asynchronous_) {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (done_) {
+        result_ = std::move(done_);
+        done_.reset();
+      }
+    }
+    if (result_ && result_->version == version) {
+      return result_;
+    }
+    return std::nullopt;
+  }
+
+ protected:
+  BoardAnalysis Analyse(const Grid& grid, uint64_t version) {
+    const auto moves = grid.EnumerateMoves();
+
+    return BoardAnalysis { version, ChooseHint(moves, mode_, engine_), moves.empty() };
+  }
+
+  void Work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;) {
+      wake_up_.wait(lock, [this] { return stop_ || has_request_; });
+      if (stop_) {
+        return;
+      }
+      // The request and the grid being analysed trade places, so Request
+      // can fill the slot again meanwhile
+      std::swap(request_, analysing_);
+      has_request_ = false;
+
+      const auto version = request_version_;
+
+      lock.unlock();
+
+      auto analysis = Analyse(*analysing_, version);
+
+      lock.lock();
+      done_ = std::move(analysis);
+    }
+  }
+
+ private:
+  HintMode mode_;
+  std::mt19937 engine_; // Only used by the one analysis that runs at a time
+  bool asynchronous_;
+  uint64_t requested_ = 0;
+  std::optional<BoardAnalysis> result_;
+  std::mutex mutex_; // Guards everything below but the grid being analysed
+  std::condition_variable wake_up_;
+  bool stop_ = false;
+  bool has_request_ = false;
+  uint64_t request_version_ = 0;
+  std::optional<Grid> request_;
+  std::optional<Grid> analysing_;
+  std::optional<BoardAnalysis> done_;
+  std::thread worker_;
+};
@@ -0,0 +1,265 @@
+#include "board_batch.h"
+#include "sprite.h"
+
+#include <algorithm>
+
+namespace {
+
+const uint8_t kEmpty = SpriteID::Empty;
+const uint8_t kOutside = 0xff;
+
+// True when v at a cell makes a match with its neighbours. Along the axis of
+// the swap only the side facing away from the other cell is looked at, as the
+// other cell holds a different value after the swap.
+inline uint8_t MakesMatch(uint8_t v, uint8_t back1, uint8_t back2, uint8_t side1, uint8_t side2, uint8_t other_side1, uint8_t other_side2) {
+  const uint8_t line = (back1 == v) & (back2 == v);
+  const uint8_t s1 = (side1 == v);
+  const uint8_t s2 = s1 & (side2 == v);
+  const uint8_t o1 = (other_side1 == v);
+  const uint8_t o2 = o1 & (other_side2 == v);
+
+  return line | ((s1 + s2 + o1 + o2) >= 2);
+}
+
+}
+
+BoardBatch::BoardBatch(int boards, uint32_t seed, int max_steps)
+    : boards_(boards), max_steps_(max_steps), cells_(kCells * boards, kEmpty), outside_(boards, kOutside),
+      matched_(kCells * boards), unique_matches_(boards), chains_(boards), moves_(kMoves * boards),
+      swapped_(boards), scores_(boards), steps_(boards) {
+  generators_.reserve(boards);
+  refills_.reserve(boards);
+  for (int board = 0; board < boards_; ++board) {
+    const uint64_t board_seed = (static_cast<uint64_t>(seed) << 32) | static_cast<uint32_t>(board);
+
+    // Seeded the way Grid seeds its generator and refills
+    generators_.emplace_back(board_seed);
+    refills_.emplace_back(~board_seed);
+    Generate(board);
+  }
+}
+
+void BoardBatch::Reset(int board, uint32_t seed) {
+  generators_.at(board).Seed(seed);
+  refills_[board].Seed(~static_cast<uint64_t>(seed));
+  Generate(board);
+  scores_[board].Reset();
+  steps_[board] = 0;
+}
+
+void BoardBatch::Set(int board, const std::vector<std::vector<int>>& grid) {
+  for (int row = 0; row < kRows; ++row) {
+    for (int col = 0; col < kCols; ++col) {
+      Cell(board, row, col) = static_cast<uint8_t>(grid.at(row).at(col));
+    }
+  }
+}
+
+void BoardBatch::Step(const std::vector<int>& moves, StepResult& result) {
+  result.rewards.assign(boards_, 0);
+  result.done.assign(boards_, 0);
+
+  std::fill(swapped_.begin(), swapped_.end(), 0);
+  for (int board = 0; board < boards_; ++board) {
+    const int move = moves.at(board);
+
+    if (move >= 0 && move < kMoves) {
+      const auto [p1, p2] = GetMove(move);
+
+      std::swap(Cell(board, p1.first, p1.second), Cell(board, p2.first, p2.second));
+      swapped_[board] = 1;
+    }
+  }
+  DetectMatches();
+  // Like Board::ButtonPressed a swap without any match is undone
+  for (int board = 0; board < boards_; ++board) {
+    if (swapped_[board] && 0 == unique_matches_[board]) {
+      const auto [p1, p2] = GetMove(moves[board]);
+
+      std::swap(Cell(board, p1.first, p1.second), Cell(board, p2.first, p2.second));
+      swapped_[board] = 0;
+    }
+  }
+  for (bool cascading = true; cascading;) {
+    cascading = false;
+    for (int board = 0; board < boards_; ++board) {
+      if (unique_matches_[board] > 0) {
+        result.rewards[board] += scores_[board].Update(unique_matches_[board], chains_[board]);
+        RemoveMatches(board);
+        cascading = true;
+      }
+    }
+    if (cascading) {
+      DetectMatches();
+    }
+  }
+  for (int board = 0; board < boards_; ++board) {
+    if (swapped_[board]) {
+      // The board is stable again without matches
+      scores_[board].ResetConsecutiveMatches();
+    }
+    if (max_steps_ > 0 && ++steps_[board] >= max_steps_) {
+      result.done[board] = 1;
+      Generate(board);
+      scores_[board].Reset();
+      steps_[board] = 0;
+    }
+  }
+  FindValidMoves(0, boards_);
+  for (int board = 0; board < boards_; ++board) {
+    bool dead_board = true;
+
+    for (int move = 0; move < kMoves && dead_board; ++move) {
+      dead_board = (0 == moves_[static_cast<size_t>(move) * boards_ + board]);
+    }
+    if (dead_board) {
+      // Grid::Collaps also creates a new board, keeping the score
+      Generate(board);
+      FindValidMoves(board, board + 1);
+    }
+  }
+  CopyValidMoves(result.valid_moves);
+}
+
+void BoardBatch::GetValidMoves(std::vector<uint8_t>& valid_moves) {
+  FindValidMoves(0, boards_);
+  CopyValidMoves(valid_moves);
+}
+
+void BoardBatch::CopyValidMoves(std::vector<uint8_t>& valid_moves) const {
+  valid_moves.resize(static_cast<size_t>(kMoves) * boards_);
+  for (int move = 0; move < kMoves; ++move) {
+    for (int board = 0; board < boards_; ++board) {
+      valid_moves[static_cast<size_t>(board) * kMoves + move] = moves_[static_cast<size_t>(move) * boards_ + board];
+    }
+  }
+}
+
+void BoardBatch::Generate(int board) {
+  do {
+    for (int row = 0; row < kRows; ++row) {
+      for (int col = 0; col < kCols; ++col) {
+        // Leave out the colours that would complete a run to the left or above
+        const uint8_t left = (col >= 2 && Cell(board, row, col - 1) == Cell(board, row, col - 2)) ? Cell(board, row, col - 1) : kEmpty;
+        const uint8_t above = (row >= 2 && Cell(board, row - 1, col) == Cell(board, row - 2, col)) ? Cell(board, row - 1, col) : kEmpty;
+
+        Cell(board, row, col) = generators_[board].NextExcept(static_cast<SpriteID>(left), static_cast<SpriteID>(above));
+      }
+    }
+  } while (!HasValidMove(board));
+}
+
+void BoardBatch::DetectMatches() {
+  const size_t n = boards_;
+  uint8_t *chains = chains_.data();
+  uint8_t *unique_matches = unique_matches_.data();
+
+  std::fill(matched_.begin(), matched_.end(), 0);
+  std::fill(chains_.begin(), chains_.end(), 0);
+  // A run of three starting at a cell marks all three cells, and is a new
+  // chain unless the cell before it has the same value
+  for (int row = 0; row < kRows; ++row) {
+    for (int col = 0; col < kCols; ++col) {
+      const uint8_t *a = &cells_[Lane(row, col)];
+
+      if (col + 2 < kCols) {
+        const uint8_t *b = &cells_[Lane(row, col + 1)];
+        const uint8_t *c = &cells_[Lane(row, col + 2)];
+        const uint8_t *before = LaneOrOutside(row, col - 1);
+        uint8_t *ma = &matched_[Lane(row, col)];
+        uint8_t *mb = &matched_[Lane(row, col + 1)];
+        uint8_t *mc = &matched_[Lane(row, col + 2)];
+
+        for (size_t i = 0; i < n; ++i) {
+          const uint8_t run = (a[i] == b[i]) & (a[i] == c[i]) & (a[i] < kEmpty);
+
+          ma[i] |= run;
+          mb[i] |= run;
+          mc[i] |= run;
+          chains[i] += run & (before[i] != a[i]);
+        }
+      }
+      if (row + 2 < kRows) {
+        const uint8_t *b = &cells_[Lane(row + 1, col)];
+        const uint8_t *c = &cells_[Lane(row + 2, col)];
+        const uint8_t *before = LaneOrOutside(row - 1, col);
+        uint8_t *ma = &matched_[Lane(row, col)];
+        uint8_t *mb = &matched_[Lane(row + 1, col)];
+        uint8_t *mc = &matched_[Lane(row + 2, col)];
+
+        for (size_t i = 0; i < n; ++i) {
+          const uint8_t run = (a[i] == b[i]) & (a[i] == c[i]) & (a[i] < kEmpty);
+
+          ma[i] |= run;
+          mb[i] |= run;
+          mc[i] |= run;
+          chains[i] += run & (before[i] != a[i]);
+        }
+      }
+    }
+  }
+  std::fill(unique_matches_.begin(), unique_matches_.end(), 0);
+  for (int cell = 0; cell < kCells; ++cell) {
+    const uint8_t *m = &matched_[cell * n];
+
+    for (size_t i = 0; i < n; ++i) {
+      unique_matches[i] += m[i];
+    }
+  }
+}
+
+void BoardBatch::FindValidMoves(int first_board, int last_board) {
+  for (int move = 0; move < kMoves; ++move) {
+    const auto [p1, p2] = GetMove(move);
+    const int dr = p2.first - p1.first;
+    const int dc = p2.second - p1.second;
+    // p1 gets the value of p2 and the other way around
+    const uint8_t *a = LaneOrOutside(p1.first, p1.second);
+    const uint8_t *b = LaneOrOutside(p2.first, p2.second);
+    const uint8_t *a_back1 = LaneOrOutside(p1.first - dr, p1.second - dc);
+    const uint8_t *a_back2 = LaneOrOutside(p1.first - 2 * dr, p1.second - 2 * dc);
+    const uint8_t *a_side1 = LaneOrOutside(p1.first - dc, p1.second - dr);
+    const uint8_t *a_side2 = LaneOrOutside(p1.first - 2 * dc, p1.second - 2 * dr);
+    const uint8_t *a_other1 = LaneOrOutside(p1.first + dc, p1.second + dr);
+    const uint8_t *a_other2 = LaneOrOutside(p1.first + 2 * dc, p1.second + 2 * dr);
+    const uint8_t *b_back1 = LaneOrOutside(p2.first + dr, p2.second + dc);
+    const uint8_t *b_back2 = LaneOrOutside(p2.first + 2 * dr, p2.second + 2 * dc);
+    const uint8_t *b_side1 = LaneOrOutside(p2.first - dc, p2.second - dr);
+    const uint8_t *b_side2 = LaneOrOutside(p2.first - 2 * dc, p2.second - 2 * dr);
+    const uint8_t *b_other1 = LaneOrOutside(p2.first + dc, p2.second + dr);
+    const uint8_t *b_other2 = LaneOrOutside(p2.first + 2 * dc, p2.second + 2 * dr);
+    uint8_t *valid = &moves_[static_cast<size_t>(move) * boards_];
+
+    for (int i = first_board; i < last_board; ++i) {
+      valid[i] = MakesMatch(b[i], a_back1[i], a_back2[i], a_side1[i], a_side2[i], a_other1[i], a_other2[i]) |
+          MakesMatch(a[i], b_back1[i], b_back2[i], b_side1[i], b_side2[i], b_other1[i], b_other2[i]);
+    }
+  }
+}
+
+bool BoardBatch::HasValidMove(int board) {
+  FindValidMoves(board, board + 1);
+  for (int move = 0; move < kMoves; ++move) {
+    if (moves_[static_cast<size_t>(move) * boards_ + board]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BoardBatch::RemoveMatches(int board) {
+  for (int col = 0; col < kCols; ++col) {
+    int to = kRows - 1;
+
+    for (int row = kRows - 1; row >= 0; --row) {
+      if (!matched_[Lane(row, col) + board]) {
+        Cell(board, to--, col) = Cell(board, row, col);
+      }
+    }
+    // Grid::Collaps puts one new piece on top of a column with a hole per
+    // call, so the first piece popped from the column's stream ends up lowest
+    for (int row = to; row >= 0; --row) {
+      Cell(board, row, col) = static_cast<uint8_t>(refills_[board].Pop(col));
+    }
+  }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "score_rules.h"
+#include "piece_generator.h"
+#include "refill_source.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Steps many boards in lockstep, e.g. for training. The boards are stored as a
+// struct of arrays, cell by cell, so the same cell of every board is one
+// contiguous lane and match detection runs over all boards at once in
+// branch-free loops the compiler vectorises. Cascades are resolved with the
+// rules of calling Grid::Collaps until the board is stable and are scored with
+// ScoreRules. Like Grid every board refills its columns from a RefillSource,
+// so the pieces that drop follow the same per-column rule as in the game.
+class BoardBatch final {
+ public:
+  // Every horizontal swap (row, col) <-> (row, col + 1) comes first, followed
+  // by every vertical swap (row, col) <-> (row + 1, col)
+  static constexpr int kHorizontalMoves = kRows * (kCols - 1);
+  static constexpr int kMoves = kHorizontalMoves + (kRows - 1) * kCols;
+  static constexpr int kCells = kRows * kCols;
+
+  struct StepResult {
+    std::vector<int> rewards;
+    std::vector<uint8_t> done;
+    std::vector<uint8_t> valid_moves; // kMoves per board
+  };
+
+  // With max_steps > 0 a board is done, and starts over, after that many steps
+  BoardBatch(int boards, uint32_t seed, int max_steps = 0);
+
+  BoardBatch(const BoardBatch&) = delete;
+
+  int size() const { return boards_; }
+
+  static std::pair<std::pair<int, int>, std::pair<int, int>> GetMove(int move) {
+    if (move < kHorizontalMoves) {
+      return { { move / (kCols - 1), move % (kCols - 1) }, { move / (kCols - 1), move % (kCols - 1) + 1 } };
+    }
+    move -= kHorizontalMoves;
+
+    return { { move / kCols, move % kCols }, { move / kCols + 1, move % kCols } };
+  }
+
+  // Gives the board a new layout and resets its score
+  void Reset(int board, uint32_t seed);
+
+  // One move per board, a move that is out of range or does not give a match
+  // leaves the board as it is. The result vectors are resized as needed, so
+  // reusing the same StepResult avoids allocating on every step.
+  void Step(const std::vector<int>& moves, StepResult& result);
+
+  void GetValidMoves(std::vector<uint8_t>& valid_moves);
+
+  uint8_t At(int board, int row, int col) const { return cells_[Lane(row, col) + board]; }
+
+  const ScoreRules& GetScore(int board) const { return scores_[board]; }
+
+  // The streams a board is generated and refilled from, e.g. to play the
+  // same board on a Grid
+  const PieceGenerator& GetGenerator(int board) const { return generators_[board]; }
+
+  const RefillSource& GetRefills(int board) const { return refills_[board]; }
+
+  // This function is only used by the test suit
+  void Set(int board, const std::vector<std::vector<int>>& grid);
+
+ protected:
+  size_t Lane(int row, int col) const { return static_cast<size_t>(row * kCols + col) * boards_; }
+
+  // Returns the lane of the cell, or a lane that never matches anything when
+  // the cell is outside the board
+  const uint8_t *LaneOrOutside(int row, int col) const {
+    if (row < 0 || row >= kRows || col < 0 || col >= kCols) {
+      return outside_.data();
+    }
+    return &cells_[Lane(row, col)];
+  }
+
+  uint8_t& Cell(int board, int row, int col) { return cells_[Lane(row, col) + board]; }
+
+  void Generate(int board);
+
+  void DetectMatches();
+
+  void FindValidMoves(int first_board, int last_board);
+
+  bool HasValidMove(int board);
+
+  // Transposes the valid moves from move major to board major
+  void CopyValidMoves(std::vector<uint8_t>& valid_moves) const;
+
+  void RemoveMatches(int board);
+
+ private:
+  int boards_;
+  int max_steps_;
+  std::vector<uint8_t> cells_;
+  std::vector<uint8_t> outside_;
+  std::vector<uint8_t> matched_;
+  std::vector<uint8_t> unique_matches_;
+  std::vector<uint8_t> chains_;
+  std::vector<uint8_t> moves_; // Move major, one lane per move
+  std::vector<uint8_t> swapped_;
+  std::vector<ScoreRules> scores_;
+  std::vector<int> steps_;
+  std::vector<PieceGenerator> generators_;
+  std::vector<RefillSource> refills_;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "grid.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Starting boards made ahead of time on a thread of their own, so taking one
+// is a pop under a lock. The boards come from the factory, a Grid is only
+// constructed once Generate has found a move on it. Take gives nullptr when
+// the pool has run dry and the caller makes the board itself, the hits and
+// misses are counted.
+class BoardPool final {
+ public:
+  using Factory = std::function<std::unique_ptr<Grid>()>;
+
+  struct Statistics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  BoardPool(size_t depth, Factory factory) : depth_(depth), factory_(std::move(factory)) {
+    if (depth_ > 0) {
+      thread_ = std::thread([this] { Fill(); });
+    }
+  }
+
+  BoardPool(const BoardPool&) = delete;
+
+  ~BoardPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      quit_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  std::unique_ptr<Grid> Take() {
+    std::unique_ptr<Grid> grid;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (boards_.empty()) {
+        statistics_.misses++;
+        return nullptr;
+      }
+      grid = std::move(boards_.front());
+      boards_.pop_front();
+      statistics_.hits++;
+    }
+    cv_.notify_one();
+
+    return grid;
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return boards_.size();
+  }
+
+  Statistics GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return statistics_;
+  }
+
+ protected:
+  void Fill() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;) {
+      cv_.wait(lock, [this] { return quit_ || boards_.size() < depth_; });
+      if (quit_) {
+        return;
+      }
+      lock.unlock();
+      auto grid = factory_();
+      lock.lock();
+      boards_.push_back(std::move(grid));
+    }
+  }
+
+ private:
+  size_t depth_;
+  Factory factory_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<Grid>> boards_;
+  Statistics statistics_;
+  bool quit_ = false;
+  std::thread thread_;
+};
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "timer.h"
+#include "timer_wheel.h"
 
 #include <cstddef>
 
@@ -24,6 +24,8 @@ const int kRows = 9;
 const int kCols = 8;
 const int kShowHintTimer = 10;
 const int kIdlePenaltyTimer = 3;
+const int kScoreStepMs = 100; // How often the displayed score moves towards the real one
+const int kIdleQuantumUs = 1000; // The longest slice an idle job gets at a time
 const int kInitialThresholdStep = 1;
 const int kThresholdMultiplier = 100;
 const int kBoardStartX = 340;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <SDL.h>
+
+// The game draws and creates textures through these, so the metrics can
+// count the draw calls and the textures per frame
+inline int CountedRenderCopy(SDL_Renderer *renderer, SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst) {
+  Metrics::Get().Add(Metric::DrawCalls);
+
+  return SDL_RenderCopy(renderer, texture, src, dst);
+}
+
+inline int CountedRenderFillRect(SDL_Renderer *renderer, const SDL_Rect *rc) {
+  Metrics::Get().Add(Metric::DrawCalls);
+
+  return SDL_RenderFillRect(renderer, rc);
+}
+
+inline SDL_Texture *CountedCreateTextureFromSurface(SDL_Renderer *renderer, SDL_Surface *surface) {
+  Metrics::Get().Add(Metric::TexturesCreated);
+
+  return SDL_CreateTextureFromSurface(renderer, surface);
+}
+
+inline SDL_Texture *CountedCreateTexture(SDL_Renderer *renderer, Uint32 format, int access, int w, int h) {
+  Metrics::Get().Add(Metric::TexturesCreated);
+
+  return SDL_CreateTexture(renderer, format, access, w, h);
+}
+
+inline void CountedDestroyTexture(SDL_Texture *texture) {
+  Metrics::Get().Add(Metric::TexturesDestroyed);
+  SDL_DestroyTexture(texture);
+}
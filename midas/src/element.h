@@ -1,12 +1,15 @@
 #pragma once
 
 #include "asset_manager.h"
+#include "draw_calls.h"
+
+#include <array>
 
 class Element final {
  public:
-  Element() : sprite_(std::make_shared<Sprite>(SpriteID::Empty)) {}
+  Element() : sprite_(GetBareSprite(SpriteID::Empty)) {}
 
-  explicit Element(SpriteID id) : sprite_(std::make_shared<Sprite>(id)) {}
+  explicit Element(SpriteID id) : sprite_(GetBareSprite(id)) {}
 
   explicit Element(const std::shared_ptr<const Sprite>& sprite) : sprite_(sprite) {}
 
@@ -49,9 +52,9 @@ class Element final {
     SDL_Rect rc { x, y, kSpriteWidth, kSpriteHeight };
 
     if (is_selected_) {
-      SDL_RenderCopy(renderer, sprite_->selected_sprite(), nullptr, &rc);
+      CountedRenderCopy(renderer, sprite_->selected_sprite(), nullptr, &rc);
     } else {
-      SDL_RenderCopy(renderer, sprite_->sprite(), nullptr, &rc);
+      CountedRenderCopy(renderer, sprite_->sprite(), nullptr, &rc);
     }
   }
 
@@ -61,6 +64,25 @@ class Element final {
   }
 
  private:
+  // A sprite without textures is the same for every element with its id, so
+  // the animations' placeholders share one instead of allocating their own.
+  // Ids past the sprites, which only tests use, get one of their own.
+  static std::shared_ptr<const Sprite> GetBareSprite(SpriteID id) {
+    static const std::array<std::shared_ptr<const Sprite>, SpriteID::OwnedByAnimation + 1> sprites = [] {
+      std::array<std::shared_ptr<const Sprite>, SpriteID::OwnedByAnimation + 1> sprites;
+
+      for (size_t i = 0; i < sprites.size(); ++i) {
+        sprites[i] = std::make_shared<Sprite>(static_cast<SpriteID>(i));
+      }
+      return sprites;
+    }();
+
+    if (static_cast<size_t>(id) >= sprites.size()) {
+      return std::make_shared<Sprite>(id);
+    }
+    return sprites[id];
+  }
+
   std::shared_ptr<const Sprite> sprite_;
   bool is_selected_ = false;
   bool is_visible = true;
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+// A monotonic arena, an allocation bumps a pointer and nothing is given back
+// until Reset makes all of it free at once. It starts in a buffer it is
+// handed, e.g. on the stack, and takes blocks from the heap when that runs
+// out. Reset then swaps the buffer for one block that fits everything the
+// last round needed, so a workload that repeats stops touching the heap.
+class Arena {
+ public:
+  Arena(void *buffer, size_t size)
+      : begin_(static_cast<char *>(buffer)), size_(size), current_(begin_), end_(begin_ + size), block_size_(size) {}
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void *Allocate(size_t size, size_t alignment) {
+    auto *p = Align(current_, alignment);
+
+    if (p > end_ || size > static_cast<size_t>(end_ - p)) {
+      p = Grow(size, alignment);
+    }
+    current_ = p + size;
+
+    return p;
+  }
+
+  // Everything allocated since the last Reset must be dead
+  void Reset() {
+    if (!overflow_.empty()) {
+      for (const auto& block : overflow_) {
+        size_ += block.second;
+      }
+      overflow_.clear();
+      owned_ = std::make_unique<char[]>(size_);
+      begin_ = owned_.get();
+    }
+    current_ = begin_;
+    end_ = begin_ + size_;
+    block_size_ = size_;
+  }
+
+  size_t GetCapacity() const { return size_; }
+
+  size_t GetOverflowBlocks() const { return overflow_.size(); }
+
+ protected:
+  static char *Align(char *p, size_t alignment) {
+    const auto address = reinterpret_cast<uintptr_t>(p);
+
+    return p + ((alignment - address % alignment) % alignment);
+  }
+
+  char *Grow(size_t size, size_t alignment) {
+    block_size_ = std::max(2 * block_size_, size + alignment);
+    overflow_.emplace_back(std::make_unique<char[]>(block_size_), block_size_);
+    current_ = overflow_.back().first.get();
+    end_ = current_ + block_size_;
+
+    return Align(current_, alignment);
+  }
+
+ private:
+  char *begin_; // The buffer that Reset goes back to
+  size_t size_;
+  char *current_;
+  char *end_; // Of the block allocated from
+  size_t block_size_;
+  std::unique_ptr<char[]> owned_;
+  std::vector<std::pair<std::unique_ptr<char[]>, size_t>> overflow_;
+};
+
+// An arena that starts out in a buffer of its own, for scratch space on the stack
+template<size_t kSize>
+class InlineArena final : public Arena {
+ public:
+  InlineArena() : Arena(buffer_, kSize) {}
+
+ private:
+  alignas(std::max_align_t) char buffer_[kSize];
+};
+
+// Lets the standard containers allocate from an arena. Deallocating is a
+// no-op, the memory comes back when the arena is reset.
+template<class T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  ArenaAllocator(Arena& arena) noexcept : arena_(&arena) {}
+
+  template<class U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(&other.GetArena()) {}
+
+  T *allocate(size_t n) { return static_cast<T *>(arena_->Allocate(n * sizeof(T), alignof(T))); }
+
+  void deallocate(T *, size_t) noexcept {}
+
+  Arena& GetArena() const { return *arena_; }
+
+  template<class U>
+  bool operator==(const ArenaAllocator<U>& other) const { return arena_ == &other.GetArena(); }
+
+  template<class U>
+  bool operator!=(const ArenaAllocator<U>& other) const { return !(*this == other); }
+
+ private:
+  Arena *arena_;
+};
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template<class T>
+using ArenaSet = std::set<T, std::less<T>, ArenaAllocator<T>>;
+
+// The render thread's arena for data that lives at most one frame, e.g. the
+// animations started by input. Board::Render resets it after the frame has
+// been presented, so nothing allocated in it may be kept past that.
+inline Arena& GetFrameArena() {
+  static InlineArena<16 * 1024> arena;
+
+  return arena;
+}
@@ -1,27 +1,55 @@
 #pragma once
 
 #include "element.h"
+#include "frame_arena.h"
+#include "metrics.h"
 #include "coordinates.h"
+#include "score_rules.h"
+#include "piece_generator.h"
+#include "refill_source.h"
+#include "trace.h"
 
 #include <set>
-#include <functional>
 #include <iterator>
 #include <tuple>
 
-namespace {
-  template<class T, class InputIt>
-  int InsertUniqueElements(std::set<T>&s, InputIt first, InputIt last ) {
-    int unique_chain = 0;
+struct MoveEvaluation {
+  Position p1;
+  Position p2;
+  int matches; // Jewels removed by the swap itself, cascades are not included
+  int chains;
+  int score;
+};
 
-    for (InputIt it = first; it != last; ++it) {
-      if (s.insert(*it).second) {
-        unique_chain = 1;
-      }
-    }
+struct CascadeStep {
+  std::vector<Position> matches;
+  int chains;
+  int score;
+};
 
-    return unique_chain;
+struct CascadeTrace {
+  std::vector<CascadeStep> steps;
+  int score_delta = 0;
+  bool new_board = false; // Set when there were no moves left and a new board was created
+};
+
+// The state of a kRows x kCols grid, see Grid::Snapshot
+struct GridSnapshot {
+  std::array<uint8_t, kRows * kCols> cells;
+  std::array<uint8_t, kRows * kCols> fill; // The pieces left of the first fill, fill_size of them
+  int fill_size;
+  uint8_t is_filling; // 0 or 1, not bools so a corrupt file can be checked
+  uint8_t is_dirty;
+  Xoshiro128::State generator;
+  RefillSource::State refills;
+
+  bool IsValid() const {
+    auto is_piece = [](uint8_t id) { return id <= SpriteID::Empty; };
+
+    return fill_size >= 0 && fill_size <= kRows * kCols && is_filling <= 1 && is_dirty <= 1 && std::all_of(cells.begin(), cells.end(), is_piece) &&
+      std::all_of(fill.begin(), fill.begin() + fill_size, is_piece) && refills.IsValid();
   }
-}
+};
 
 class Grid final {
  public:
@@ -31,6 +59,12 @@ class Grid final {
     Generate();
   }
 
+  // The same seed gives the same boards and refills
+  Grid(int rows, int cols, AssetManagerInterface* am, uint64_t seed)
+      : rows_(rows), cols_(cols), asset_manager_(am), generator_(seed), refills_(~seed) {
+    Generate();
+  }
+
   // This constructor is only used by the test suit
   Grid(const std::vector<std::vector<int>>& grid, AssetManagerInterface* am)
       : rows_(static_cast<int>(grid.size())), cols_(static_cast<int>(grid.at(0).size())), asset_manager_(am) {
@@ -60,6 +94,67 @@ class Grid final {
     return is_filling_;
   }
 
+  // True when nothing is falling and the last refill has been checked for matches
+  bool IsSettled() const {
+    if (grid_is_dirty_ || !fill_grid_.empty()) {
+      return false;
+    }
+    for (const auto& row : grid_) {
+      if (std::any_of(std::begin(row), std::end(row), [](const Element &v) { return v == SpriteID::Empty; })) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Captures everything needed to continue the grid exactly where it is, the
+  // refills included. It is only reads and copies, nothing is allocated.
+  void Snapshot(GridSnapshot& snapshot) const {
+    CheckSnapshotSize();
+    for (int row = 0; row < rows_; ++row) {
+      for (int col = 0; col < cols_; ++col) {
+        snapshot.cells[row * cols_ + col] = static_cast<uint8_t>(At(row, col).id());
+      }
+    }
+    snapshot.fill_size = 0;
+    for (const auto& row : fill_grid_) {
+      for (const auto& e : row) {
+        snapshot.fill[snapshot.fill_size++] = static_cast<uint8_t>(e.id());
+      }
+    }
+    snapshot.is_filling = is_filling_ ? 1 : 0;
+    snapshot.is_dirty = grid_is_dirty_ ? 1 : 0;
+    snapshot.generator = generator_.GetState();
+    refills_.GetState(snapshot.refills);
+  }
+
+  void Restore(const GridSnapshot& snapshot) {
+    CheckSnapshotSize();
+    for (int row = 0; row < rows_; ++row) {
+      for (int col = 0; col < cols_; ++col) {
+        At(row, col) = Element(asset_manager_->GetSprite(static_cast<SpriteID>(snapshot.cells[row * cols_ + col])));
+      }
+    }
+    fill_grid_.clear();
+    for (int i = 0; i < snapshot.fill_size; ++i) {
+      if (i % cols_ == 0) {
+        fill_grid_.emplace_back();
+      }
+      fill_grid_.back().emplace_back(asset_manager_->GetSprite(static_cast<SpriteID>(snapshot.fill[i])));
+    }
+    is_filling_ = (snapshot.is_filling != 0);
+    grid_is_dirty_ = (snapshot.is_dirty != 0);
+    generator_.SetState(snapshot.generator);
+    refills_.SetState(snapshot.refills);
+  }
+
+  // Gives the board new refills, e.g. so a simulation does not know the
+  // pieces the game will actually drop
+  void Reseed(uint64_t seed) {
+    generator_.Seed(seed);
+    refills_.Seed(~seed);
+  }
+
   inline const Element& At(int row, int col) const { return grid_.at(row).at(col); }
 
   inline Element& At(int row, int col) { return grid_.at(row).at(col); }
@@ -87,14 +182,18 @@ class Grid final {
   }
 
   void Generate(GenerateType type = GenerateType::Fill) {
+    TRACE_ZONE("Grid::Generate");
+
     do {
       grid_.clear();
       grid_.resize(rows_, std::vector<Element>(cols_, Element(asset_manager_->GetSprite(SpriteID::Empty))));
       for (int row = 0; row < rows_; ++row) {
         for (int col = 0; col < cols_; ++col) {
-          do {
-            At(row, col) = Element(asset_manager_->GetSprite());
-          } while(IsMatch(row, col));
+          // Leave out the colours that would complete a run to the left or above
+          const SpriteID left = (col >= 2 && At(row, col - 1) == At(row, col - 2)) ? At(row, col - 1).id() : SpriteID::Empty;
+          const SpriteID above = (row >= 2 && At(row - 1, col) == At(row - 2, col)) ? At(row - 1, col).id() : SpriteID::Empty;
+
+          At(row, col) = Element(asset_manager_->GetSprite(generator_.NextExcept(left, above)));
         }
       }
     } while (!FindPotentialMatches().first);
@@ -107,13 +206,72 @@ class Grid final {
     }
   }
 
+  // For a board where no move makes a match. Nothing is logged, rollouts
+  // replace many boards and the game logs its own.
+  void ReplaceDeadBoard() { Generate(Grid::GenerateType::NoFill); }
+
+  // As above with the pieces of a board fresh from the constructor, e.g.
+  // one made in the background, instead of running Generate
+  void ReplaceDeadBoard(const Grid& fresh) {
+    if (fresh.fill_grid_.size() != static_cast<size_t>(rows_)) {
+      ReplaceDeadBoard();
+      return;
+    }
+    grid_ = fresh.fill_grid_;
+  }
+
+  // The pieces that will drop into each column next, for solvers and replays
+  const RefillSource& GetRefills() const { return refills_; }
+
+  void TopUpRefills() { refills_.TopUp(); }
+
   inline std::pair<std::vector<Position>, int> GetAllMatches() const {
-    return Matches(0, 0, rows_, cols_);
+    std::vector<Position> matches;
+    const int chains = GetAllMatches(matches);
+
+    return std::make_pair(matches, chains);
+  }
+
+  // Gives the matches in matches, which keeps its capacity, and returns the chains
+  int GetAllMatches(std::vector<Position>& matches) const {
+    Metrics::Get().Add(Metric::GridScans);
+
+    InlineArena<kScratchSize> arena;
+    ArenaSet<Position> all_column_matches(arena);
+    ArenaSet<Position> all_row_matches(arena);
+    int chains = 0;
+
+    for (int col = 0; col < cols_; ++col) {
+      chains += LineMatches(0, col, 1, 0, all_column_matches);
+    }
+    for (int row = 0; row < rows_; ++row) {
+      chains += LineMatches(row, 0, 0, 1, all_row_matches);
+    }
+    matches.assign(all_column_matches.begin(), all_column_matches.end());
+    matches.insert(matches.end(), all_row_matches.begin(), all_row_matches.end());
+
+    return chains;
   }
 
   std::tuple<std::vector<Position>, std::vector<Position>, int> Collaps(int& consecutive_matches, int& previous_consecutive_matches) {
-    bool grid_is_unstable = false;
     std::vector<Position> moved_objects;
+    std::vector<Position> matches;
+    const int chains = Collaps(consecutive_matches, previous_consecutive_matches, moved_objects, matches);
+
+    return std::make_tuple(moved_objects, matches, chains);
+  }
+
+  // As above, into vectors the caller keeps between frames so their capacity
+  // is reused. Without replace_dead_board a stable board without moves is
+  // left for the caller to replace, e.g. when it finds out in the background.
+  int Collaps(int& consecutive_matches, int& previous_consecutive_matches, std::vector<Position>& moved_objects,
+              std::vector<Position>& matches, bool replace_dead_board = true) {
+    TRACE_ZONE("Grid::Collaps");
+
+    bool grid_is_unstable = false;
+
+    moved_objects.clear();
+    matches.clear();
 
     for (int row = rows_ - 1;row >= 1; --row) {
       for (int col = 0; col < cols_; ++col) {
@@ -130,7 +288,7 @@ class Grid final {
       if (At(0, col).IsEmpty()) {
         bool filling = !fill_grid_.empty();
 
-        At(0, col) = (filling) ? fill_grid_.back().back() : Element(asset_manager_->GetSprite(col));
+        At(0, col) = (filling) ? fill_grid_.back().back() : Element(asset_manager_->GetSprite(refills_.Pop(col)));
         if (filling) {
           fill_grid_.back().pop_back();
           if (fill_grid_.back().empty()) {
@@ -143,14 +301,12 @@ class Grid final {
       }
     }
     int chains = 0;
-    std::vector<Position> matches;
 
     if (!grid_is_unstable && grid_is_dirty_) {
-      asset_manager_->ResetPreviousIds();
-      std::tie(matches, chains) = GetAllMatches();
+      chains = GetAllMatches(matches);
       if (matches.size() == 0) {
-        if (!FindPotentialMatches().first) {
-          Generate(Grid::GenerateType::NoFill);
+        if (replace_dead_board && !FindPotentialMatches().first) {
+          ReplaceDeadBoard();
           std::cout << "No solutions found, creating a new board" << std::endl;
         }
         consecutive_matches = 0;
@@ -158,20 +314,76 @@ class Grid final {
       }
       grid_is_dirty_ = false;
     }
-    return std::make_tuple(moved_objects, matches, chains);
+    return chains;
+  }
+
+  // Does in one call what calling Collaps once a frame, and removing every
+  // match it returns, does until the board is stable: the pieces are refilled
+  // in the same order and the matches are scored with the same rules, so both
+  // give exactly the same boards and scores.
+  CascadeTrace ResolveCascades(ScoreRules& score) {
+    CascadeTrace trace;
+
+    for (;;) {
+      Settle();
+      if (!grid_is_dirty_) {
+        break;
+      }
+      grid_is_dirty_ = false;
+
+      auto [matches, chains] = GetAllMatches();
+
+      if (matches.empty()) {
+        if (!FindPotentialMatches().first) {
+          ReplaceDeadBoard();
+          trace.new_board = true;
+        }
+        score.ResetConsecutiveMatches();
+        break;
+      }
+      const int step_score = score.Update(std::set<Position>(matches.begin(), matches.end()).size(), chains);
+
+      for (const auto& p : matches) {
+        At(p) = Element(asset_manager_->GetSprite(SpriteID::Empty));
+      }
+      trace.score_delta += step_score;
+      trace.steps.push_back({ std::move(matches), chains, step_score });
+    }
+    return trace;
   }
 
+  // Gives the same matches and chains as calling GetAllMatches with p1 and p2
+  // swapped, but only scans the rows and columns of the two cells as they are
+  // the only ones a swap can change. Matches elsewhere, which a stable board
+  // never has, are not reported.
   std::pair<std::vector<Position>, int> GetMatchesFromSwap(const Position& p1, const Position& p2) {
+    InlineArena<kScratchSize> arena;
+    ArenaSet<Position> all_column_matches(arena);
+    ArenaSet<Position> all_row_matches(arena);
+    int chains = 0;
+
+    std::swap(At(p1), At(p2));
+    chains += LineMatches(0, p1.col(), 1, 0, all_column_matches);
+    if (p2.col() != p1.col()) {
+      chains += LineMatches(0, p2.col(), 1, 0, all_column_matches);
+    }
+    chains += LineMatches(p1.row(), 0, 0, 1, all_row_matches);
+    if (p2.row() != p1.row()) {
+      chains += LineMatches(p2.row(), 0, 0, 1, all_row_matches);
+    }
     std::swap(At(p1), At(p2));
 
-    auto ret_value = GetAllMatches();
+    std::vector<Position> matches(all_column_matches.begin(), all_column_matches.end());
 
-    std::swap(At(p1), At(p2));
+    matches.insert(matches.end(), all_row_matches.begin(), all_row_matches.end());
 
-    return ret_value;
+    return std::make_pair(matches, chains);
   }
 
   std::pair<bool, std::pair<Position, Position>> FindPotentialMatches() {
+    TRACE_ZONE("Grid::FindPotentialMatches");
+    Metrics::Get().Add(Metric::GridScans);
+
     std::pair<std::vector<Position>, int> matches_chains;
     std::pair<Position, Position> positions;
 
@@ -198,6 +410,32 @@ class Grid final {
     return std::make_pair(false, positions);
   }
 
+  // Evaluates every swap of two neighbours in one sweep. Only the runs through
+  // the two swapped cells are looked at, which on a board without matches are
+  // the only ones a swap can create. Swaps without a match are left out.
+  std::vector<MoveEvaluation> EnumerateMoves() const {
+    std::vector<MoveEvaluation> moves;
+
+    Metrics::Get().Add(Metric::GridScans);
+    for (int row = 0; row < rows_; ++row) {
+      for (int col = 0; col < cols_; ++col) {
+        const Position p1(row, col);
+
+        for (const auto& p2 : { Position(row, col + 1), Position(row + 1, col) }) {
+          if (p2.row() >= rows_ || p2.col() >= cols_) {
+            continue;
+          }
+          auto [matches, chains] = EvaluateSwap(p1, p2);
+
+          if (matches > 0) {
+            moves.push_back({ p1, p2, matches, chains, GetBasicScore(matches) });
+          }
+        }
+      }
+    }
+    return moves;
+  }
+
   void Render(SDL_Renderer *renderer) const {
     for (int row = 0; row < rows_; ++row) {
       for (int col = 0; col < cols_; ++col) {
@@ -217,70 +455,116 @@ class Grid final {
   }
 
  protected:
-  using GetValue = std::function<Element(int i)>;
-  using GetPosition = std::function<Position(int i)>;
+  // Stack space for the match sets of a scan, a full board of matches fits
+  static constexpr size_t kScratchSize = 8 * 1024;
 
-  std::pair<std::vector<Position>, int> Matches(int start_row, int start_col, int rows, int cols) const {
+  // Adds every run of kMatchNumber or more in the line starting at row, col
+  // to matches and returns the number of runs
+  int LineMatches(int row, int col, int drow, int dcol, ArenaSet<Position>& matches) const {
+    auto on_grid = [this](int r, int c) { return r >= 0 && r < rows_ && c >= 0 && c < cols_; };
     int chains = 0;
-    std::set<Position> all_column_matches;
-    std::set<Position> all_row_matches;
-
-    for (auto row = start_row; row < rows; ++row) {
-      for (auto col = start_col; col < cols; ++col) {
-        auto column_matches = GetColumnMatches(row, col);
 
-        chains += InsertUniqueElements(all_column_matches, std::begin(column_matches), std::end(column_matches));
+    while (on_grid(row, col)) {
+      const auto& value = At(row, col);
+      int length = 1;
 
-        auto row_matches = GetRowMatches(row, col);
-
-        chains += InsertUniqueElements(all_row_matches, std::begin(row_matches), std::end(row_matches));
+      while (!value.IsEmpty() && on_grid(row + length * drow, col + length * dcol) && At(row + length * drow, col + length * dcol) == value) {
+        length++;
+      }
+      if (!value.IsEmpty() && length >= static_cast<int>(kMatchNumber)) {
+        for (int i = 0; i < length; ++i) {
+          matches.emplace(row + i * drow, col + i * dcol);
+        }
+        chains++;
       }
+      row += length * drow;
+      col += length * dcol;
     }
-    std::vector<Position> matches;
-    std::copy(all_column_matches.begin(), all_column_matches.end(), std::back_inserter(matches));
-    std::copy(all_row_matches.begin(), all_row_matches.end(), std::back_inserter(matches));
-
-    return std::make_pair(matches, chains);
+    return chains;
   }
 
-  std::vector<Position> Matches(int row, int col, int start, int end, GetValue value_at, GetPosition pos) const {
-    std::vector<Position> matches;
+  // Number of cells next to p, in the direction given, with the same value
+  // as value once p1 and p2 have been swapped
+  int RunLength(const Position& p, const Element& value, int drow, int dcol, const Position& p1, const Position& p2) const {
+    int length = 0;
 
-    matches.emplace_back(row, col);
-    // check lower bounds
-    const auto& value = At(row, col);
+    for (int row = p.row() + drow, col = p.col() + dcol; row >= 0 && row < rows_ && col >= 0 && col < cols_; row += drow, col += dcol) {
+      const Position pos(row, col);
+      const auto& e = (pos == p1) ? At(p2) : (pos == p2) ? At(p1) : At(pos);
 
-    for (int i = start - 1; i >= 0; i--) {
-      if (value_at(i) != value || value_at(i).IsEmpty()) {
-        break;
-      }
-      matches.emplace_back(pos(i));
-    }
-    // check upper bounds
-    for (int i = start + 1; i < end; i++) {
-      if (value_at(i) != value || value_at(i).IsEmpty()) {
+      if (e != value || e.IsEmpty()) {
         break;
       }
-      matches.emplace_back(pos(i));
+      length++;
     }
-    if (matches.size() < kMatchNumber) {
-      matches.clear();
-    }
-    return matches;
+    return length;
   }
 
-  std::vector<Position> GetColumnMatches(int row, int col) const {
-    auto value_at = [this, col](int row) { return At(row, col); };
-    auto pos = [col](int row) { return Position(row, col); };
+  // Jewels and chains matched by swapping p1 and p2, without touching the grid
+  std::pair<int, int> EvaluateSwap(const Position& p1, const Position& p2) const {
+    int matches = 0;
+    int chains = 0;
+
+    for (const auto& [p, value] : { std::make_pair(p1, &At(p2)), std::make_pair(p2, &At(p1)) }) {
+      if (value->IsEmpty()) {
+        continue;
+      }
+      const int horizontal = 1 + RunLength(p, *value, 0, -1, p1, p2) + RunLength(p, *value, 0, 1, p1, p2);
+      const int vertical = 1 + RunLength(p, *value, -1, 0, p1, p2) + RunLength(p, *value, 1, 0, p1, p2);
+      const bool horizontal_match = horizontal >= static_cast<int>(kMatchNumber);
+      const bool vertical_match = vertical >= static_cast<int>(kMatchNumber);
 
-    return Matches(row, col, row, rows_, value_at, pos);
+      matches += (horizontal_match ? horizontal : 0) + (vertical_match ? vertical : 0) - (horizontal_match && vertical_match);
+      chains += horizontal_match + vertical_match;
+    }
+    return std::make_pair(matches, chains);
   }
 
-  std::vector<Position> GetRowMatches(int row, int col) const {
-    auto value_at = [this, row](int col) { return At(row, col); };
-    auto pos = [row](int col) { return Position(row, col); };
+  void CheckSnapshotSize() const {
+    if (rows_ != kRows || cols_ != kCols) {
+      std::cout << "Snapshots need a " << kRows << "x" << kCols << " grid, not " << rows_ << "x" << cols_ << std::endl;
+      exit(-1);
+    }
+  }
 
-    return Matches(row, col, col, cols_, value_at, pos);
+  // Moves every piece down past the empty cells below it in one pass per
+  // column and fills the columns from the top. Collaps adds one piece to the
+  // top of every column with a hole per call, from the last column to the
+  // first, so the piece added first ends up lowest.
+  void Settle() {
+    std::vector<int> holes(cols_);
+    int max_holes = 0;
+
+    for (int col = 0; col < cols_; ++col) {
+      int to = rows_ - 1;
+
+      for (int row = rows_ - 1; row >= 0; --row) {
+        if (!At(row, col).IsEmpty()) {
+          if (row != to) {
+            std::swap(At(to, col), At(row, col));
+          }
+          to--;
+        }
+      }
+      holes[col] = to + 1;
+      max_holes = std::max(max_holes, holes[col]);
+    }
+    for (int round = 0; round < max_holes; ++round) {
+      for (int col = cols_ - 1; col >= 0; --col) {
+        if (holes[col] > round) {
+          bool filling = !fill_grid_.empty();
+
+          At(holes[col] - 1 - round, col) = (filling) ? fill_grid_.back().back() : Element(asset_manager_->GetSprite(refills_.Pop(col)));
+          if (filling) {
+            fill_grid_.back().pop_back();
+            if (fill_grid_.back().empty()) {
+              fill_grid_.pop_back();
+            }
+          }
+          grid_is_dirty_ = !filling;
+        }
+      }
+    }
   }
 
  private:
@@ -291,4 +575,6 @@ class Grid final {
   std::vector<std::vector<Element>> grid_;
   std::vector<std::vector<Element>> fill_grid_;
   AssetManagerInterface* asset_manager_ = nullptr;
+  PieceGenerator generator_;
+  RefillSource refills_;
 };
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "asset_manager.h"
+
+// Hands out sprites without any textures so the game logic can run without a
+// renderer
+class HeadlessAssetManager final : public AssetManagerInterface {
+ public:
+  HeadlessAssetManager() {
+    for (int id = SpriteID::Blue; id <= SpriteID::Empty; ++id) {
+      sprites_.push_back(std::make_shared<Sprite>(static_cast<SpriteID>(id)));
+    }
+  }
+
+  virtual std::shared_ptr<const Sprite> GetSprite(SpriteID id) const override {
+    if (id > SpriteID::Empty) {
+      return sprites_[SpriteID::Empty];
+    }
+    return sprites_.at(id);
+  }
+
+ private:
+  std::vector<std::shared_ptr<const Sprite>> sprites_;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "grid.h"
+
+#include <optional>
+#include <random>
+#include <tuple>
+
+enum class HintMode { Best, Random, LeastObvious };
+
+// Best picks the move removing the most jewels and chains, LeastObvious the
+// one removing the fewest. Ties, and Random, are picked at random so the
+// hints do not cluster in the top left corner of the board.
+inline std::optional<MoveEvaluation> ChooseHint(const std::vector<MoveEvaluation>& moves, HintMode mode, std::mt19937& engine) {
+  if (moves.empty()) {
+    return std::nullopt;
+  }
+  const int sign = (mode == HintMode::LeastObvious) ? -1 : 1;
+  auto key = [sign](const MoveEvaluation& m) { return std::make_tuple(sign * m.score, sign * m.chains, sign * m.matches); };
+  InlineArena<2048> arena;
+  ArenaVector<const MoveEvaluation*> candidates(arena);
+
+  candidates.reserve(moves.size());
+
+  for (const auto& move : moves) {
+    if (mode != HintMode::Random && !candidates.empty()) {
+      const auto best = key(*candidates.front());
+      const auto current = key(move);
+
+      if (current < best) {
+        continue;
+      } else if (best < current) {
+        candidates.clear();
+      }
+    }
+    candidates.push_back(&move);
+  }
+  return *candidates.at(std::uniform_int_distribution<size_t>(0, candidates.size() - 1)(engine));
+}
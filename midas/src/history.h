@@ -0,0 +1,126 @@
+#pragma once
+
+#include "snapshot.h"
+
+#include <cstring>
+#include <vector>
+
+// The states of the last kCapacity moves of a game, for undo and rewind.
+// Every kKeyframeInterval:th state is stored in full, the others as the byte
+// ranges that changed since the state before them, so a state is rebuilt
+// from at most kKeyframeInterval - 1 deltas. The buffers are reused when the
+// ring wraps around, so the memory use levels off after the first lap.
+class GameHistory final {
+ public:
+  static constexpr int kCapacity = 512; // Well above the moves of a kGameTime game
+  static constexpr int kKeyframeInterval = 16;
+
+  static_assert(kCapacity % kKeyframeInterval == 0, "The ring must hold whole keyframe intervals");
+
+  GameHistory() : entries_(kCapacity) {}
+
+  void Clear() {
+    total_ = 0;
+    oldest_ = 0;
+  }
+
+  // Number of moves that can be rewound
+  int size() const { return std::max(total_ - 1 - oldest_, 0); }
+
+  void Record(const GameSnapshot& state) {
+    auto& entry = entries_[total_ % kCapacity];
+
+    entry.clear();
+    if (total_ % kKeyframeInterval == 0) {
+      entry.resize(kSize);
+      std::memcpy(entry.data(), &state, kSize);
+    } else {
+      Encode(last_, state, entry);
+    }
+    last_ = state;
+    total_++;
+    // The slot just written held a state kCapacity moves back, the states
+    // after it that lost their keyframe are out of reach too. Never moves
+    // back, a rewind does not bring overwritten states back.
+    const int first = total_ - kCapacity;
+
+    oldest_ = std::max(oldest_, (first + kKeyframeInterval - 1) / kKeyframeInterval * kKeyframeInterval);
+  }
+
+  // Gives the state from moves moves ago and forgets the states after it
+  bool Rewind(int moves, GameSnapshot& state) {
+    const int index = total_ - 1 - moves;
+
+    if (moves < 0 || index < oldest_) {
+      return false;
+    }
+    const int keyframe = index - index % kKeyframeInterval;
+
+    std::memcpy(&last_, entries_[keyframe % kCapacity].data(), kSize);
+    for (int i = keyframe + 1; i <= index; ++i) {
+      Decode(entries_[i % kCapacity], last_);
+    }
+    state = last_;
+    total_ = index + 1;
+
+    return true;
+  }
+
+  size_t GetMemoryUsage() const {
+    size_t bytes = sizeof(*this) + entries_.capacity() * sizeof(entries_[0]);
+
+    for (const auto& entry : entries_) {
+      bytes += entry.capacity();
+    }
+    return bytes;
+  }
+
+ protected:
+  static constexpr size_t kSize = sizeof(GameSnapshot);
+  static constexpr size_t kMergeGap = 8; // Ranges closer than this are stored as one
+
+  static_assert(kSize <= UINT16_MAX, "Offsets are stored in 16 bits");
+
+  // Stores every changed range as a 16-bit offset, a 16-bit length and the new bytes
+  static void Encode(const GameSnapshot& from, const GameSnapshot& to, std::vector<uint8_t>& delta) {
+    const auto *a = reinterpret_cast<const uint8_t *>(&from);
+    const auto *b = reinterpret_cast<const uint8_t *>(&to);
+
+    for (size_t i = 0; i < kSize;) {
+      if (a[i] == b[i]) {
+        ++i;
+        continue;
+      }
+      size_t end = i + 1;
+
+      for (size_t j = end; j < kSize && j < end + kMergeGap; ++j) {
+        if (a[j] != b[j]) {
+          end = j + 1;
+        }
+      }
+      const uint16_t header[] = { static_cast<uint16_t>(i), static_cast<uint16_t>(end - i) };
+
+      delta.insert(delta.end(), reinterpret_cast<const uint8_t *>(header), reinterpret_cast<const uint8_t *>(header) + sizeof(header));
+      delta.insert(delta.end(), b + i, b + end);
+      i = end;
+    }
+  }
+
+  static void Decode(const std::vector<uint8_t>& delta, GameSnapshot& state) {
+    auto *bytes = reinterpret_cast<uint8_t *>(&state);
+
+    for (size_t i = 0; i < delta.size();) {
+      uint16_t header[2];
+
+      std::memcpy(header, &delta[i], sizeof(header));
+      std::memcpy(bytes + header[0], &delta[i + sizeof(header)], header[1]);
+      i += sizeof(header) + header[1];
+    }
+  }
+
+ private:
+  std::vector<std::vector<uint8_t>> entries_;
+  GameSnapshot last_;
+  int total_ = 0;
+  int oldest_ = 0; // The oldest state that can be rebuilt
+};
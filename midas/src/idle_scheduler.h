@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Runs incremental jobs in the time a frame has left once it is presented.
+// A job does one slice of its work per call, stopping at the deadline it is
+// given, and returns true while it has more to do. The jobs take turns a
+// quantum at a time so a long one does not hold up the others, and no slice
+// is started with less than a quantum left of the budget.
+class IdleScheduler final {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Job = std::function<bool(Clock::time_point deadline)>;
+
+  struct Statistics {
+    uint64_t frames = 0;
+    uint64_t slices = 0;
+    uint64_t jobs_done = 0;
+    double slack_seconds = 0.0; // Offered to the jobs
+    double busy_seconds = 0.0; // Used by them
+
+    double GetUsage() const { return (slack_seconds > 0.0) ? busy_seconds / slack_seconds : 0.0; }
+  };
+
+  explicit IdleScheduler(std::chrono::microseconds quantum) : quantum_(quantum) {}
+
+  void Post(Job job) { jobs_.push_back(std::move(job)); }
+
+  bool HasJobs() const { return !jobs_.empty(); }
+
+  std::chrono::microseconds GetQuantum() const { return quantum_; }
+
+  // Runs slices until the deadline and returns the time they took
+  Clock::duration Run(Clock::time_point deadline) {
+    const auto start = Clock::now();
+    auto now = start;
+
+    while (!jobs_.empty() && deadline - now >= quantum_) {
+      next_ %= jobs_.size();
+      if (jobs_[next_](std::min(now + quantum_, deadline))) {
+        next_++;
+      } else {
+        jobs_.erase(jobs_.begin() + next_);
+        statistics_.jobs_done++;
+      }
+      statistics_.slices++;
+      now = Clock::now();
+    }
+    statistics_.frames++;
+    statistics_.slack_seconds += std::chrono::duration<double>(std::max(deadline - start, Clock::duration::zero())).count();
+    statistics_.busy_seconds += std::chrono::duration<double>(now - start).count();
+
+    return now - start;
+  }
+
+  const Statistics& GetStatistics() const { return statistics_; }
+
+ private:
+  std::chrono::microseconds quantum_;
+  std::vector<Job> jobs_;
+  size_t next_ = 0;
+  Statistics statistics_;
+};
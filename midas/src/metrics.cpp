@@ -0,0 +1,54 @@
+#include "metrics.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Counts the heap allocations of the game for Metric::Allocations. Only the
+// game is built with this file, the tests and tools allocate as usual.
+
+void *operator new(size_t size) {
+  Metrics::Get().Add(Metric::Allocations);
+  if (void *p = std::malloc((size > 0) ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+MetricsLog::MetricsLog(const std::string& file, double interval) : fs_(file), interval_(interval) {
+  if (!fs_) {
+    std::cout << "Failed to open " << file << std::endl;
+    exit(-1);
+  }
+  fs_ << "seconds,frames";
+  for (int i = 0; i < kMetrics; ++i) {
+    fs_ << "," << Metrics::GetName(static_cast<Metric>(i));
+  }
+  fs_ << std::endl;
+}
+
+void MetricsLog::Update(double delta) {
+  const auto& metrics = Metrics::Get();
+
+  for (int i = 0; i < kMetrics; ++i) {
+    sums_[i] += metrics.GetLastFrame(static_cast<Metric>(i));
+  }
+  frames_++;
+  elapsed_ += delta;
+  time_ += delta;
+  if (elapsed_ < interval_) {
+    return;
+  }
+  fs_ << time_ << "," << frames_;
+  for (auto& sum : sums_) {
+    fs_ << "," << static_cast<double>(sum) / frames_;
+    sum = 0;
+  }
+  fs_ << std::endl;
+  frames_ = 0;
+  elapsed_ = 0.0;
+}
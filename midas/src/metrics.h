@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Counters count events, e.g. draw calls, and are shown as their increase
+// per frame. Gauges hold a current value, e.g. the animations running.
+enum class Metric { DrawCalls, TexturesCreated, TexturesDestroyed, Allocations, SoundsPlayed, SoundsDropped, GridScans,
+                    ActiveAnimations, QueuedAnimations, IdleWorkUs, Count };
+
+const int kMetrics = static_cast<int>(Metric::Count);
+
+// Updated from the hot paths on any thread, an update is one relaxed atomic
+// operation. EndFrame and the per frame values belong to the render thread.
+class Metrics final {
+ public:
+  static Metrics& Get() {
+    static Metrics metrics;
+
+    return metrics;
+  }
+
+  static const char *GetName(Metric metric) {
+    static const char *kNames[] = { "draw_calls", "textures_created", "textures_destroyed", "allocations", "sounds_played",
+                                    "sounds_dropped", "grid_scans", "active_animations", "queued_animations",
+                                    "idle_work_us" };
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == kMetrics, "Every metric needs a name");
+
+    return kNames[static_cast<int>(metric)];
+  }
+
+  static bool IsGauge(Metric metric) { return metric >= Metric::ActiveAnimations; }
+
+  void Add(Metric metric, int64_t n = 1) { values_[static_cast<int>(metric)].fetch_add(n, std::memory_order_relaxed); }
+
+  void Set(Metric metric, int64_t value) { values_[static_cast<int>(metric)].store(value, std::memory_order_relaxed); }
+
+  int64_t GetTotal(Metric metric) const { return values_[static_cast<int>(metric)].load(std::memory_order_relaxed); }
+
+  // The increase of a counter during the last frame, or the gauge at its end
+  int64_t GetLastFrame(Metric metric) const { return last_frame_[static_cast<int>(metric)]; }
+
+  uint64_t GetFrames() const { return frames_; }
+
+  void EndFrame() {
+    for (int i = 0; i < kMetrics; ++i) {
+      const int64_t value = values_[i].load(std::memory_order_relaxed);
+
+      last_frame_[i] = IsGauge(static_cast<Metric>(i)) ? value : value - frame_start_[i];
+      frame_start_[i] = value;
+    }
+    frames_++;
+  }
+
+ protected:
+  Metrics() = default;
+
+ private:
+  std::array<std::atomic<int64_t>, kMetrics> values_ {};
+  std::array<int64_t, kMetrics> frame_start_ {};
+  std::array<int64_t, kMetrics> last_frame_ {};
+  uint64_t frames_ = 0;
+};
+
+// Appends a CSV line every interval with the mean per frame of every metric
+// since the line before, so a creeping allocation count shows as a trend.
+class MetricsLog final {
+ public:
+  MetricsLog(const std::string& file, double interval);
+
+  // Call once per frame, after Metrics::EndFrame
+  void Update(double delta);
+
+ private:
+  std::ofstream fs_;
+  double interval_;
+  double elapsed_ = 0.0;
+  double time_ = 0.0;
+  int frames_ = 0;
+  std::array<int64_t, kMetrics> sums_ {};
+};
@@ -1,12 +1,62 @@
 #include "board.h"
-#include "timer.h"
+#include "metrics.h"
+#include "process_stats.h"
+#include "startup_profiler.h"
+#include "trace.h"
 
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
 #include <thread>
 #include <sstream>
 
 namespace {
 
-void InsertAnimation(std::vector<std::shared_ptr<Animation>>& animations, const std::shared_ptr<Animation>& a) {
+#if defined(MIDAS_TRACE)
+const std::string kTraceFile("midas-trace.json");
+#endif
+
+const std::vector<std::pair<Uint32, const char *>> kSDLSubsystems = {
+  { SDL_INIT_TIMER, "SDL_Init(SDL_INIT_TIMER)" },
+  { SDL_INIT_AUDIO, "SDL_Init(SDL_INIT_AUDIO)" },
+  { SDL_INIT_VIDEO, "SDL_Init(SDL_INIT_VIDEO)" },
+  { SDL_INIT_EVENTS, "SDL_Init(SDL_INIT_EVENTS)" },
+  { SDL_INIT_JOYSTICK, "SDL_Init(SDL_INIT_JOYSTICK)" },
+  { SDL_INIT_HAPTIC, "SDL_Init(SDL_INIT_HAPTIC)" },
+  { SDL_INIT_GAMECONTROLLER, "SDL_Init(SDL_INIT_GAMECONTROLLER)" },
+#if defined(SDL_INIT_SENSOR)
+  { SDL_INIT_SENSOR, "SDL_Init(SDL_INIT_SENSOR)" },
+#endif
+};
+
+// When profiling, the subsystems are started one at a time so the report
+// shows what each of them costs, e.g. joystick and haptic which are unused.
+bool InitSDL(Uint32 subsystems) {
+  if (!StartupProfiler::Get().IsEnabled()) {
+    return SDL_Init(subsystems) == 0;
+  }
+  StartupStage stage("SDL_Init");
+
+  if (SDL_Init(0) != 0) {
+    return false;
+  }
+  for (const auto& [subsystem, name] : kSDLSubsystems) {
+    if ((subsystems & subsystem) == subsystem) {
+      StartupStage subsystem_stage(name);
+
+      if (SDL_InitSubSystem(subsystem) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+double Percentile(const std::vector<double>& sorted, double p) {
+  return sorted.at(static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+}
+
+void InsertAnimation(Animations& animations, const std::shared_ptr<Animation>& a) {
   if (a) {
     animations.emplace_back(a);
   }
@@ -16,18 +66,30 @@ void InsertAnimation(std::vector<std::shared_ptr<Animation>>& animations, const
 
 class MidasMiner {
  public:
-  MidasMiner() {
-    if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
+  explicit MidasMiner(const Options& options) : options_(options) {
+    const auto& audio = options_.audio;
+    // The null and offline audio backends never touch the audio device, so
+    // they also work on machines without any sound hardware
+    Uint32 subsystems = (options_.minimal_sdl_init) ? (SDL_INIT_TIMER | SDL_INIT_AUDIO | SDL_INIT_VIDEO) : SDL_INIT_EVERYTHING;
+
+    if (audio.backend != AudioBackend::SdlMixer) {
+      subsystems &= ~SDL_INIT_AUDIO;
+    }
+    StartupProfiler::Get().Annotate("sdl_subsystems", options_.minimal_sdl_init ? "minimal" : "everything");
+
+    if (!InitSDL(subsystems)) {
       std::cout << "SDL_Init Error: " << SDL_GetError() << std::endl;
       exit(-1);
     }
-    if (TTF_Init() != 0) {
+    if (StartupStage stage("TTF_Init"); TTF_Init() != 0) {
       std::cout << "TTF_Init Error: " << TTF_GetError() << std::endl;
       exit(-1);
     }
-    if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 1024) != 0) {
-      std::cout << "Mix_OpenAudio Error: " << Mix_GetError() << std::endl;
-      exit(-1);
+    if (audio.backend == AudioBackend::SdlMixer) {
+      if (StartupStage stage("Mix_OpenAudio"); Mix_OpenAudio(audio.frequency, MIX_DEFAULT_FORMAT, audio.channels, audio.buffer_size) != 0) {
+        std::cout << "Mix_OpenAudio Error: " << Mix_GetError() << std::endl;
+        exit(-1);
+      }
     }
   }
 
@@ -38,19 +100,40 @@ class MidasMiner {
     Mix_Quit();
   }
 
-  static void Play() {
-    Board board;
+  void Play() {
+    TRACE_ZONE("MidasMiner::Play");
+
+    Board board(options_);
     bool quit = false;
     bool music_on = true;
-    Timer show_hint_timer(kShowHintTimer);
-    Timer idle_penalty_timer(kIdlePenaltyTimer);
-    DeltaTimer delta_timer;
-    std::vector<std::shared_ptr<Animation>> animations;
+    std::unique_ptr<Autoplayer> autoplayer;
+    std::unique_ptr<MetricsLog> metrics_log;
+    GameSnapshot session;
+    const auto frame_budget = std::chrono::duration_cast<IdleScheduler::Clock::duration>(
+        std::chrono::duration<double>((options_.max_fps > 0) ? 1.0 / options_.max_fps : 0.0));
+    bool has_session = !options_.session.empty() && ReadSnapshot(options_.session, session);
+
+    if (has_session) {
+      board.Restore(session);
+    }
+
+    if (options_.autoplay) {
+      autoplayer = std::make_unique<Autoplayer>(options_.autoplay_config);
+    }
+    if (!options_.metrics_log.empty()) {
+      metrics_log = std::make_unique<MetricsLog>(options_.metrics_log, options_.metrics_interval);
+    }
+    board.ResetIdleTimers();
+    // The one clock read of a frame, the game time moves on by the time
+    // since the last one
+    auto previous_frame_start = IdleScheduler::Clock::now();
 
     while (!quit) {
+      TRACE_FRAME();
+      const auto frame_start = IdleScheduler::Clock::now();
+      Animations animations(GetFrameArena());
       SDL_Event event;
 
-      animations.clear();
       while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) {
           quit = true;
@@ -63,10 +146,20 @@ class MidasMiner {
               break;
             } else if (SDL_SCANCODE_SPACE == event.key.keysym.scancode) {
               board.Restart(music_on);
+              board.SetPaused(false);
+              animations.clear();
+              board.ResetIdleTimers();
+            } else if (options_.practice && SDL_SCANCODE_U == event.key.keysym.scancode && board.Rewind(1)) {
               animations.clear();
-              idle_penalty_timer.Reset();
-              show_hint_timer.Reset();
-              delta_timer.Reset();
+              board.ResetIdleTimers();
+            } else if (!board.IsGameOver() && SDL_SCANCODE_P == event.key.keysym.scancode) {
+              board.SetPaused(!board.IsPaused());
+#if defined(MIDAS_TRACE)
+            } else if (SDL_SCANCODE_T == event.key.keysym.scancode) {
+              Tracer::Get().Write(kTraceFile);
+#endif
+            } else if (SDL_SCANCODE_F3 == event.key.keysym.scancode) {
+              board.ToggleMetrics();
             } else if (!board.IsGameOver() && SDL_SCANCODE_M == event.key.keysym.scancode) {
               music_on = !music_on;
               if (music_on) {
@@ -97,29 +190,183 @@ class MidasMiner {
           case SDL_MOUSEBUTTONDOWN:
             switch (event.button.button) {
               case SDL_BUTTON_LEFT:
+                if (board.IsPaused()) {
+                  break;
+                }
                 board.BoardNotIdle();
-                idle_penalty_timer.Reset();
-                show_hint_timer.Reset();
+                board.ResetIdleTimers();
                 animations = board.ButtonPressed(Position(pixel_to_row(event.motion.y), pixel_to_col(event.motion.x)));
                 break;
             }
         }
       }
-      if (idle_penalty_timer.IsZero()) {
-        board.DecreseScore();
-        idle_penalty_timer.Reset();
+      if (autoplayer && board.IsIdle() && !board.IsPaused()) {
+        if (auto move = autoplayer->Poll(board.GetGrid(), board.GetScore(), board.GetVersion()); move) {
+          board.BoardNotIdle();
+          board.ClearSelection();
+          board.ResetIdleTimers();
+          board.ButtonPressed(move->p1);
+          for (const auto& a : board.ButtonPressed(move->p2)) {
+            InsertAnimation(animations, a);
+          }
+        }
+      }
+      // The offline mix follows the game time, so it steps a fixed frame
+      // at a time and renders the same WAV however long the frames take
+      const auto frame_time = (options_.audio.backend == AudioBackend::Offline) ?
+          std::chrono::duration_cast<IdleScheduler::Clock::duration>(std::chrono::duration<double>(kTimeResolution)) :
+          frame_start - previous_frame_start;
+      const double delta = board.GetGameDelta(frame_time);
+
+      previous_frame_start = frame_start;
+
+      board.Render(animations, delta);
+      if (metrics_log) {
+        metrics_log->Update(delta);
+      }
+      // Kept for --session, the last state where nothing moved
+      if (!options_.session.empty() && board.IsIdle()) {
+        board.Snapshot(session);
+        has_session = true;
       }
-      if (show_hint_timer.IsZero()) {
-        InsertAnimation(animations, board.ShowHint());
-        show_hint_timer.Reset();
+      if (StartupProfiler::Get().IsEnabled()) {
+        StartupProfiler::Get().WriteReport();
+        quit = true;
       }
-      board.Render(animations, delta_timer.GetDelta());
+      if (frame_budget.count() > 0) {
+        board.RunIdleJobs(frame_start + frame_budget);
+        std::this_thread::sleep_until(frame_start + frame_budget);
+      } else {
+        // Uncapped there is no slack, the jobs get a quantum every frame
+        board.RunIdleJobs(IdleScheduler::Clock::now() + std::chrono::microseconds(kIdleQuantumUs));
+      }
+    }
+    if (!options_.session.empty()) {
+      if (board.IsGameOver() || !has_session) {
+        std::remove(options_.session.c_str());
+      } else if (!WriteSnapshot(options_.session, session)) {
+        std::cout << "Failed to save the session to " << options_.session << std::endl;
+      }
+    }
+#if defined(MIDAS_TRACE)
+    Tracer::Get().Write(kTraceFile);
+#endif
+    const auto& audio = board.GetAsset().GetAudio();
+    const auto statistics = audio.GetStatistics();
+
+    std::cout << "Sounds played: " << statistics.played << " coalesced: " << statistics.coalesced
+              << " pre-empted: " << statistics.preempted << " dropped: " << statistics.dropped
+              << " peak voices: " << statistics.peak_voices << " mixer load: " << statistics.mixer_load * 100.0 << "%" << std::endl;
+    if (statistics.latency_samples > 0) {
+      std::cout << "Sound latency (" << statistics.latency_samples << " sounds): average " << statistics.average_latency_ms
+                << " ms, max " << statistics.max_latency_ms << " ms" << std::endl;
+    }
+    const auto& idle = board.GetIdleStatistics();
+    const auto pool = board.GetBoardPoolStatistics();
+
+    std::cout << "Idle jobs: " << idle.jobs_done << " done in " << idle.slices << " slices, " << idle.busy_seconds * 1000.0
+              << " ms of " << idle.slack_seconds * 1000.0 << " ms slack (" << idle.GetUsage() * 100.0 << "%)" << std::endl;
+    std::cout << "Board pool: " << pool.hits << " hits, " << pool.misses << " misses" << std::endl;
+    if (autoplayer) {
+      autoplayer->Stop();
+      const auto& autoplay = autoplayer->GetStatistics();
+
+      std::cout << "Autoplay: " << autoplay.rollouts << " rollouts, " << autoplay.RolloutsPerSecond() << " rollouts/s" << std::endl;
+    }
+#if defined(MIDAS_BUILTIN_MUSIC_DECODER)
+    std::cout << "Resident set size: " << GetResidentSetSize() << " KiB (streamed music)" << std::endl;
+#else
+    std::cout << "Resident set size: " << GetResidentSetSize() << " KiB (SDL_mixer music)" << std::endl;
+#endif
+  }
+
+  // Lets the best hint play a seeded game as fast as the frames can be drawn.
+  // The game time advances a fixed step per frame, so every run draws the
+  // same frames on every machine and only the time they take differs.
+  void Benchmark() {
+    Board board(options_);
+    std::mt19937 engine(static_cast<uint32_t>(options_.seed));
+    const double delta = options_.benchmark_speed / kFPS;
+    const size_t frames = static_cast<size_t>(options_.benchmark_frames);
+    std::vector<double> frame_times;
+    std::unique_ptr<MetricsLog> metrics_log;
+    int moves = 0;
+    bool quit = false;
+    const auto draw_calls = Metrics::Get().GetTotal(Metric::DrawCalls);
+    const auto allocations = Metrics::Get().GetTotal(Metric::Allocations);
+    const auto start = std::chrono::steady_clock::now();
+
+    if (!options_.metrics_log.empty()) {
+      metrics_log = std::make_unique<MetricsLog>(options_.metrics_log, options_.metrics_interval);
+    }
+    while (!quit && !board.IsGameOver() && (frames == 0 || frame_times.size() < frames)) {
+      TRACE_FRAME();
+      const auto frame_start = std::chrono::steady_clock::now();
+      Animations animations(GetFrameArena());
+      SDL_Event event;
+
+      while (SDL_PollEvent(&event)) {
+        quit = quit || event.type == SDL_QUIT || (event.type == SDL_KEYDOWN && SDL_SCANCODE_Q == event.key.keysym.scancode);
+      }
+      if (board.IsIdle()) {
+        if (auto move = ChooseHint(board.GetGrid().EnumerateMoves(), HintMode::Best, engine); move) {
+          board.ButtonPressed(move->p1);
+          animations = board.ButtonPressed(move->p2);
+          moves++;
+        }
+      }
+      board.Render(animations, delta);
+      if (metrics_log) {
+        metrics_log->Update(delta);
+      }
+      frame_times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count());
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto sorted = frame_times;
+
+    std::sort(sorted.begin(), sorted.end());
+    std::cout << std::fixed << std::setprecision(2)
+              << "Benchmark: " << frame_times.size() << " frames, " << moves << " moves, score " << board.GetScore().Get()
+              << " in " << seconds << " s, average " << frame_times.size() / seconds << " FPS" << std::endl;
+    if (!sorted.empty()) {
+      std::cout << "Frame time: mean " << std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size()
+                << " ms p50 " << Percentile(sorted, 0.5) << " ms p90 " << Percentile(sorted, 0.9)
+                << " ms p99 " << Percentile(sorted, 0.99) << " ms max " << sorted.back() << " ms" << std::endl;
+      std::cout << "Per frame: " << static_cast<double>(Metrics::Get().GetTotal(Metric::DrawCalls) - draw_calls) / sorted.size()
+                << " draw calls, " << static_cast<double>(Metrics::Get().GetTotal(Metric::Allocations) - allocations) / sorted.size()
+                << " allocations" << std::endl;
     }
+    std::cout << "Peak resident set size: " << GetPeakResidentSetSize() << " KiB" << std::endl;
+#if defined(MIDAS_TRACE)
+    Tracer::Get().Write(kTraceFile);
+#endif
   }
+
+ private:
+  Options options_;
 };
 
-int main(int, char * []) {
-  MidasMiner midas_miner;
+int main(int argc, char *argv[]) {
+  auto& startup_profiler = StartupProfiler::Get();
+  const auto options = ParseOptions(argc, argv);
+
+  if (!options.startup_report.empty()) {
+    startup_profiler.Enable(options.startup_report);
+  }
+  if (options.autoplay_games > 0) {
+    RunHeadlessGames(options.autoplay_config, options.autoplay_games, options.autoplay_moves);
+
+    return 0;
+  }
+  if (options.benchmark_frames >= 0) {
+    auto benchmark_options = options;
+
+    benchmark_options.seed = std::max(options.seed, 1);
+    MidasMiner(benchmark_options).Benchmark();
+
+    return 0;
+  }
+  MidasMiner midas_miner(options);
 
   midas_miner.Play();
 
@@ -0,0 +1,224 @@
+#include "midas_engine.h"
+#include "headless_asset_manager.h"
+#include "grid.h"
+#include "score_rules.h"
+#include "snapshot.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <set>
+
+struct midas_game {
+  HeadlessAssetManager asset_manager;
+  std::unique_ptr<Grid> grid;
+  ScoreRules score;
+};
+
+namespace {
+
+bool IsOnBoard(int row, int col) { return row >= 0 && row < kRows && col >= 0 && col < kCols; }
+
+bool IsMoveValid(const midas_move& move) {
+  const int distance = std::abs(move.row1 - move.row2) + std::abs(move.col1 - move.col2);
+
+  return IsOnBoard(move.row1, move.col1) && IsOnBoard(move.row2, move.col2) && distance == 1;
+}
+
+size_t UniqueMatches(const std::vector<Position>& matches) {
+  return std::set<Position>(matches.begin(), matches.end()).size();
+}
+
+void RemoveMatches(midas_game& game, const std::vector<Position>& matches, int chains, midas_step_result& result) {
+  const size_t unique_matches = UniqueMatches(matches);
+
+  result.matches += static_cast<int32_t>(unique_matches);
+  result.chains += chains;
+  result.cascades++;
+  result.score_delta += game.score.Update(unique_matches, chains);
+  for (const auto& p : matches) {
+    game.grid->At(p) = Element(game.asset_manager.GetSprite(SpriteID::Empty));
+  }
+}
+
+void Resolve(midas_game& game, midas_step_result& result) {
+  const auto trace = game.grid->ResolveCascades(game.score);
+
+  for (const auto& step : trace.steps) {
+    result.matches += static_cast<int32_t>(UniqueMatches(step.matches));
+    result.chains += step.chains;
+    result.cascades++;
+  }
+  result.score_delta += trace.score_delta;
+}
+
+void NewGame(midas_game& game, uint32_t seed) {
+  midas_step_result ignored {};
+
+  game.grid = std::make_unique<Grid>(kRows, kCols, &game.asset_manager, seed);
+  game.score.Reset();
+  Resolve(game, ignored);
+}
+
+}
+
+extern "C" {
+
+int midas_abi_version(void) { return MIDAS_ENGINE_ABI_VERSION; }
+
+int midas_rows(void) { return kRows; }
+
+int midas_cols(void) { return kCols; }
+
+midas_game *midas_create(uint32_t seed) {
+  try {
+    auto game = std::make_unique<midas_game>();
+
+    NewGame(*game, seed);
+
+    return game.release();
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void midas_destroy(midas_game *game) { delete game; }
+
+void midas_reset(midas_game *game, uint32_t seed) {
+  if (nullptr == game) {
+    return;
+  }
+  try {
+    NewGame(*game, seed);
+  } catch (...) {
+    // The game keeps its board, NewGame replaces it last
+  }
+}
+
+int midas_step(midas_game *game, const midas_move *move, midas_step_result *result) {
+  midas_step_result step_result {};
+
+  if (nullptr == game || nullptr == move || !IsMoveValid(*move)) {
+    if (nullptr != result) {
+      *result = step_result;
+    }
+    return -1;
+  }
+  try {
+    const Position p1(move->row1, move->col1);
+    const Position p2(move->row2, move->col2);
+    auto [matches, chains] = game->grid->GetMatchesFromSwap(p1, p2);
+
+    if (!matches.empty()) {
+      std::swap(game->grid->At(p1), game->grid->At(p2));
+      step_result.matched = 1;
+      RemoveMatches(*game, matches, chains, step_result);
+      Resolve(*game, step_result);
+    }
+  } catch (...) {
+    step_result = {};
+    step_result.matched = -1;
+  }
+  if (nullptr != result) {
+    *result = step_result;
+  }
+  return step_result.matched;
+}
+
+void midas_step_batch(midas_game *const *games, const midas_move *moves, midas_step_result *results, int count) {
+  if (nullptr == games || nullptr == moves) {
+    return;
+  }
+  for (int i = 0; i < count; ++i) {
+    midas_step(games[i], &moves[i], (nullptr != results) ? &results[i] : nullptr);
+  }
+}
+
+int midas_valid_moves(midas_game *game, midas_move *moves, int capacity) {
+  if (nullptr == game) {
+    return 0;
+  }
+  int found = 0;
+
+  try {
+    for (int row = 0; row < kRows; ++row) {
+      for (int col = 0; col < kCols; ++col) {
+        const midas_move candidates[] = { { row, col, row, col + 1 }, { row, col, row + 1, col } };
+
+        for (const auto& candidate : candidates) {
+          if (!IsMoveValid(candidate)) {
+            continue;
+          }
+          const Position p1(candidate.row1, candidate.col1);
+          const Position p2(candidate.row2, candidate.col2);
+
+          if (!game->grid->GetMatchesFromSwap(p1, p2).first.empty()) {
+            if (found < capacity && nullptr != moves) {
+              moves[found] = candidate;
+            }
+            found++;
+          }
+        }
+      }
+    }
+  } catch (...) {
+    return -1;
+  }
+  return found;
+}
+
+int midas_copy_state(const midas_game *game, uint8_t *cells, int capacity) {
+  if (nullptr == game || nullptr == cells || capacity < kRows * kCols) {
+    return -1;
+  }
+  try {
+    for (int row = 0; row < kRows; ++row) {
+      for (int col = 0; col < kCols; ++col) {
+        cells[row * kCols + col] = static_cast<uint8_t>(game->grid->At(row, col).id());
+      }
+    }
+  } catch (...) {
+    return -1;
+  }
+  return kRows * kCols;
+}
+
+int midas_score(const midas_game *game) { return (nullptr == game) ? 0 : game->score.Get(); }
+
+int midas_snapshot_size(void) { return static_cast<int>(sizeof(GameSnapshot)); }
+
+int midas_snapshot(const midas_game *game, void *buffer, int capacity) {
+  if (nullptr == game || nullptr == buffer || capacity < midas_snapshot_size()) {
+    return -1;
+  }
+  try {
+    GameSnapshot snapshot;
+
+    game->grid->Snapshot(snapshot.grid);
+    snapshot.score = game->score;
+    std::memcpy(buffer, &snapshot, sizeof(snapshot));
+  } catch (...) {
+    return -1;
+  }
+  return midas_snapshot_size();
+}
+
+int midas_restore(midas_game *game, const void *buffer, int size) {
+  GameSnapshot snapshot;
+
+  if (nullptr == game || nullptr == buffer || size != midas_snapshot_size()) {
+    return -1;
+  }
+  std::memcpy(&snapshot, buffer, sizeof(snapshot));
+  if (!snapshot.IsValid()) {
+    return -1;
+  }
+  try {
+    game->grid->Restore(snapshot.grid);
+    game->score = snapshot.score;
+  } catch (...) {
+    return -1;
+  }
+  return 0;
+}
+
+}
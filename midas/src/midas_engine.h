@@ -0,0 +1,97 @@
+#pragma once
+
+/* C interface to the game logic, built as the midas_engine shared library.
+ * It has no dependencies on SDL at runtime and is meant for embedding the
+ * game in trainers and analysis tools written in other languages.
+ *
+ * The layout of the structs below and the meaning of every function stay the
+ * same for a given MIDAS_ENGINE_ABI_VERSION.
+ *
+ * No C++ exception leaves a function. One that fails inside, e.g. when out of
+ * memory, returns -1 (NULL for midas_create) and a void function returns as
+ * if it had been given NULL. */
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(MIDAS_ENGINE_EXPORTS)
+#    define MIDAS_API __declspec(dllexport)
+#  else
+#    define MIDAS_API __declspec(dllimport)
+#  endif
+#else
+#  define MIDAS_API __attribute__((visibility("default")))
+#endif
+
+#define MIDAS_ENGINE_ABI_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct midas_game midas_game;
+
+typedef struct midas_move {
+  int32_t row1;
+  int32_t col1;
+  int32_t row2;
+  int32_t col2;
+} midas_move;
+
+typedef struct midas_step_result {
+  int32_t matched;     /* Non zero if the swap gave a match, otherwise the board is unchanged */
+  int32_t matches;     /* Jewels removed by the swap and all cascades following it */
+  int32_t chains;      /* Chains removed by the swap and all cascades following it */
+  int32_t cascades;    /* Number of times matches were removed, 1 when nothing cascaded */
+  int32_t score_delta;
+} midas_step_result;
+
+MIDAS_API int midas_abi_version(void);
+
+MIDAS_API int midas_rows(void);
+
+MIDAS_API int midas_cols(void);
+
+/* Returns NULL if the game could not be created */
+MIDAS_API midas_game *midas_create(uint32_t seed);
+
+MIDAS_API void midas_destroy(midas_game *game);
+
+/* Starts a new game, the same seed gives the same boards and refills */
+MIDAS_API void midas_reset(midas_game *game, uint32_t seed);
+
+/* Swaps two neighbouring jewels and resolves every cascade. Returns 1 if the
+ * swap gave a match, 0 if it did not and -1 if the move is outside the board
+ * or the jewels are not neighbours. result may be NULL. */
+MIDAS_API int midas_step(midas_game *game, const midas_move *move, midas_step_result *result);
+
+/* Steps count games with one move each. results may be NULL, otherwise it
+ * must hold count entries. Nothing is stepped when games or moves is NULL. */
+MIDAS_API void midas_step_batch(midas_game *const *games, const midas_move *moves, midas_step_result *results, int count);
+
+/* Writes up to capacity moves that give a match and returns how many there
+ * are in total, call it with capacity 0 to only count them. Returns 0 when
+ * game is NULL. */
+MIDAS_API int midas_valid_moves(midas_game *game, midas_move *moves, int capacity);
+
+/* Copies the board row by row, one byte per cell, into a caller provided
+ * buffer of at least rows * cols bytes. Returns the number of bytes written
+ * or -1 if the buffer is too small. */
+MIDAS_API int midas_copy_state(const midas_game *game, uint8_t *cells, int capacity);
+
+MIDAS_API int midas_score(const midas_game *game);
+
+MIDAS_API int midas_snapshot_size(void);
+
+/* Copies the complete state of the game, the upcoming refills included, into
+ * a caller provided buffer of at least midas_snapshot_size() bytes. Returns
+ * the number of bytes written or -1 if the buffer is too small. */
+MIDAS_API int midas_snapshot(const midas_game *game, void *buffer, int capacity);
+
+/* Continues the game from a snapshot taken of any game. Returns 0, or -1 if
+ * the buffer does not hold a snapshot made by this version of the library. */
+MIDAS_API int midas_restore(midas_game *game, const void *buffer, int size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,253 @@
+#include "music_stream.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+const Uint16 kWaveFormatPCM = 0x0001;
+const Uint16 kWaveFormatImaAdpcm = 0x0011;
+const int kPCMBlockFrames = 2048;
+const size_t kOutputBufferSize = 16 * 1024;
+
+const int kStepTable[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767
+};
+
+const int kIndexTable[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+Uint16 ReadLE16(const Uint8 *p) { return static_cast<Uint16>(p[0] | (p[1] << 8)); }
+
+Uint32 ReadLE32(const Uint8 *p) {
+  return static_cast<Uint32>(p[0]) | (static_cast<Uint32>(p[1]) << 8) |
+      (static_cast<Uint32>(p[2]) << 16) | (static_cast<Uint32>(p[3]) << 24);
+}
+
+Sint16 DecodeNibble(int nibble, int& predictor, int& index) {
+  const int step = kStepTable[index];
+  int delta = step >> 3;
+
+  if (nibble & 4) delta += step;
+  if (nibble & 2) delta += (step >> 1);
+  if (nibble & 1) delta += (step >> 2);
+
+  predictor += (nibble & 8) ? -delta : delta;
+  predictor = std::clamp(predictor, -32768, 32767);
+  index = std::clamp(index + kIndexTable[nibble & 7], 0, 88);
+
+  return static_cast<Sint16>(predictor);
+}
+
+// Decodes one IMA ADPCM block into interleaved 16-bit samples
+void DecodeImaAdpcmBlock(const Uint8 *block, int channels, int samples_per_block, Sint16 *out) {
+  for (int c = 0; c < channels; ++c) {
+    const Uint8 *header = block + (c * 4);
+    int predictor = static_cast<Sint16>(ReadLE16(header));
+    int index = std::clamp(static_cast<int>(header[2]), 0, 88);
+
+    out[c] = static_cast<Sint16>(predictor);
+
+    for (int sample = 1; sample < samples_per_block; sample += 8) {
+      const Uint8 *data = block + (4 * channels) + ((sample - 1) / 8) * 4 * channels + c * 4;
+
+      for (int i = 0; i < 8 && sample + i < samples_per_block; ++i) {
+        const int nibble = (i & 1) ? (data[i / 2] >> 4) : (data[i / 2] & 0x0f);
+
+        out[(sample + i) * channels + c] = DecodeNibble(nibble, predictor, index);
+      }
+    }
+  }
+}
+
+}
+
+MusicStream::MusicStream(const std::string& path) : path_(path) {
+  if (!Open()) {
+    std::cout << "Failed to open music stream: " << path_ << ". Error: " << SDL_GetError() << std::endl;
+  }
+}
+
+MusicStream::~MusicStream() noexcept {
+  Stop();
+  if (nullptr != converter_) {
+    SDL_FreeAudioStream(converter_);
+  }
+  if (nullptr != file_) {
+    SDL_RWclose(file_);
+  }
+}
+
+void MusicStream::Play(int fade_in_ms) {
+  if (!IsOpen()) {
+    return;
+  }
+  Stop();
+  Rewind();
+  SDL_AudioStreamClear(converter_);
+  fade_out_ms_ = -1;
+  fade_frames_ = std::max(1, fade_in_ms * device_rate_ / 1000);
+  fade_step_ = 0;
+  fade_direction_ = 1;
+  playing_ = true;
+  Mix_HookMusic(&MusicStream::Mix, this);
+}
+
+void MusicStream::Stop() {
+  // Mix_HookMusic locks the audio device, so once it returns the
+  // callback is no longer running and the state can be touched safely.
+  Mix_HookMusic(nullptr, nullptr);
+  playing_ = false;
+}
+
+void MusicStream::Mix(void *udata, Uint8 *stream, int len) {
+  auto music = static_cast<MusicStream*>(udata);
+
+  if (music->playing_) {
+    music->MixInto(stream, len);
+  }
+}
+
+bool MusicStream::Open() {
+  file_ = SDL_RWFromFile(path_.c_str(), "rb");
+  if (nullptr == file_) {
+    return false;
+  }
+  Uint8 header[12];
+
+  if (SDL_RWread(file_, header, sizeof(header), 1) != 1 || ReadLE32(header) != 0x46464952 || ReadLE32(header + 8) != 0x45564157) {
+    return false;
+  }
+  Uint16 format_tag = 0;
+  Uint32 rate = 0;
+  Uint32 data_size = 0;
+
+  for (Uint8 chunk[8]; SDL_RWread(file_, chunk, sizeof(chunk), 1) == 1;) {
+    const Uint32 id = ReadLE32(chunk);
+    const Uint32 size = ReadLE32(chunk + 4);
+    const Sint64 next = SDL_RWtell(file_) + size + (size & 1);
+
+    if (id == 0x20746d66) { // "fmt "
+      Uint8 fmt[20] = { 0 };
+
+      SDL_RWread(file_, fmt, std::min<size_t>(size, sizeof(fmt)), 1);
+      format_tag = ReadLE16(fmt);
+      channels_ = ReadLE16(fmt + 2);
+      rate = ReadLE32(fmt + 4);
+      block_align_ = ReadLE16(fmt + 12);
+      samples_per_block_ = ReadLE16(fmt + 18);
+    } else if (id == 0x74636166) { // "fact"
+      Uint8 fact[4];
+
+      SDL_RWread(file_, fact, sizeof(fact), 1);
+      total_frames_ = ReadLE32(fact);
+    } else if (id == 0x61746164) { // "data"
+      data_start_ = SDL_RWtell(file_);
+      data_size = size;
+      break;
+    }
+    SDL_RWseek(file_, next, RW_SEEK_SET);
+  }
+  if (0 == data_start_ || channels_ <= 0 || 0 == rate) {
+    return false;
+  }
+  SDL_AudioFormat source_format;
+
+  if (format_tag == kWaveFormatPCM) {
+    format_ = Format::PCM;
+    source_format = AUDIO_S16LSB;
+    samples_per_block_ = kPCMBlockFrames;
+    block_align_ = kPCMBlockFrames * channels_ * 2;
+    total_frames_ = data_size / (channels_ * 2);
+  } else if (format_tag == kWaveFormatImaAdpcm && samples_per_block_ > 0) {
+    format_ = Format::ImaAdpcm;
+    source_format = AUDIO_S16SYS;
+    if (0 == total_frames_) {
+      total_frames_ = (data_size / block_align_) * samples_per_block_;
+    }
+  } else {
+    SDL_SetError("Unsupported WAV format %d", format_tag);
+    return false;
+  }
+  int device_channels;
+
+  Mix_QuerySpec(&device_rate_, &device_format_, &device_channels);
+  device_frame_size_ = (SDL_AUDIO_BITSIZE(device_format_) / 8) * device_channels;
+
+  block_.resize(block_align_);
+  samples_.resize(samples_per_block_ * channels_);
+  output_.resize(kOutputBufferSize - (kOutputBufferSize % device_frame_size_));
+
+  converter_ = SDL_NewAudioStream(source_format, static_cast<Uint8>(channels_), static_cast<int>(rate),
+                                  device_format_, static_cast<Uint8>(device_channels), device_rate_);
+  return nullptr != converter_;
+}
+
+void MusicStream::Rewind() {
+  SDL_RWseek(file_, data_start_, RW_SEEK_SET);
+  frames_left_ = total_frames_;
+}
+
+bool MusicStream::DecodeBlock() {
+  if (0 == frames_left_) {
+    // Wrapping around inside the same callback keeps the loop gapless
+    Rewind();
+  }
+  const Uint32 frames = std::min<Uint32>(frames_left_, samples_per_block_);
+  const size_t bytes = (format_ == Format::PCM) ? frames * channels_ * 2 : block_align_;
+
+  if (SDL_RWread(file_, block_.data(), bytes, 1) != 1) {
+    return false;
+  }
+  const void *pcm = block_.data();
+
+  if (format_ == Format::ImaAdpcm) {
+    DecodeImaAdpcmBlock(block_.data(), channels_, samples_per_block_, samples_.data());
+    pcm = samples_.data();
+  }
+  frames_left_ -= frames;
+
+  return SDL_AudioStreamPut(converter_, pcm, static_cast<int>(frames * channels_ * 2)) == 0;
+}
+
+void MusicStream::MixInto(Uint8 *stream, int len) {
+  if (const int ms = fade_out_ms_.exchange(-1); ms >= 0) {
+    fade_frames_ = std::max(1, ms * device_rate_ / 1000);
+    fade_step_ = 0;
+    fade_direction_ = -1;
+  }
+  while (len > 0 && playing_) {
+    const int wanted = std::min(len, static_cast<int>(output_.size()));
+
+    while (SDL_AudioStreamAvailable(converter_) < wanted) {
+      if (!DecodeBlock()) {
+        break;
+      }
+    }
+    const int got = SDL_AudioStreamGet(converter_, output_.data(), wanted);
+
+    if (got <= 0) {
+      break;
+    }
+    int volume = volume_;
+
+    if (fade_direction_ != 0) {
+      const int step = std::min(fade_step_, fade_frames_);
+
+      volume = (fade_direction_ > 0) ? (volume * step) / fade_frames_ : (volume * (fade_frames_ - step)) / fade_frames_;
+      fade_step_ += got / device_frame_size_;
+      if (fade_step_ >= fade_frames_) {
+        playing_ = (fade_direction_ > 0);
+        fade_direction_ = 0;
+      }
+    }
+    SDL_MixAudioFormat(stream, output_.data(), device_format_, static_cast<Uint32>(got), volume);
+    stream += got;
+    len -= got;
+  }
+}
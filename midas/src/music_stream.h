@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <SDL_mixer.h>
+
+// Streams a looping WAV file (16-bit PCM or IMA ADPCM) through Mix_HookMusic.
+// Only one block of the file is decoded at a time, on the mixer thread, so the
+// memory used by the music is bounded no matter how long the track is.
+class MusicStream final {
+ public:
+  explicit MusicStream(const std::string& path);
+
+  MusicStream(const MusicStream&) = delete;
+
+  ~MusicStream() noexcept;
+
+  bool IsOpen() const { return nullptr != converter_; }
+
+  void Play(int fade_in_ms);
+
+  void FadeOut(int ms) { fade_out_ms_ = ms; }
+
+  void Stop();
+
+  void SetVolume(int volume) { volume_ = volume; }
+
+ protected:
+  static void Mix(void *udata, Uint8 *stream, int len);
+
+  bool Open();
+
+  void Rewind();
+
+  bool DecodeBlock();
+
+  void MixInto(Uint8 *stream, int len);
+
+ private:
+  enum class Format { PCM, ImaAdpcm };
+
+  std::string path_;
+  SDL_RWops *file_ = nullptr;
+  SDL_AudioStream *converter_ = nullptr;
+  Format format_ = Format::PCM;
+  int channels_ = 0;
+  int block_align_ = 0;
+  int samples_per_block_ = 0;
+  Sint64 data_start_ = 0;
+  Uint32 total_frames_ = 0;
+  Uint32 frames_left_ = 0;
+  std::vector<Uint8> block_;
+  std::vector<Sint16> samples_;
+  std::vector<Uint8> output_;
+  SDL_AudioFormat device_format_ = AUDIO_S16SYS;
+  int device_frame_size_ = 0;
+  int fade_frames_ = 0;
+  int fade_step_ = 0;
+  int fade_direction_ = 0;
+  bool playing_ = false;
+  std::atomic<int> fade_out_ms_ { -1 };
+  std::atomic<int> volume_ { MIX_MAX_VOLUME };
+  int device_rate_ = MIX_DEFAULT_FREQUENCY;
+};
@@ -0,0 +1,185 @@
+#include "offline_audio_sink.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+std::string BaseName(const std::string& path) {
+  const auto slash = path.find_last_of("/\\");
+  const auto name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+  return name.substr(0, name.find_last_of('.'));
+}
+
+std::string EventsFile(const std::string& output_file) {
+  const auto dot = output_file.find_last_of('.');
+
+  return ((dot == std::string::npos) ? output_file : output_file.substr(0, dot)) + ".csv";
+}
+
+template<class T> void WriteLE(std::ofstream& fs, T value) {
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    fs.put(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+}
+
+OfflineAudioSink::OfflineAudioSink(const AudioConfig& config, int voices)
+    : frequency_(config.frequency), channels_(config.channels), output_file_(config.output_file) {
+  sounds_.resize(HurryUp + 1);
+  voices_.resize(voices);
+  events_ = "time_ms,event,sound,voice,volume\n";
+}
+
+OfflineAudioSink::~OfflineAudioSink() noexcept {
+  Write();
+}
+
+bool OfflineAudioSink::LoadMusic(const std::string& path, int) {
+  SDL_RWops *rw = SDL_RWFromFile(path.c_str(), "rb");
+
+  if (nullptr == rw) {
+    std::cout << "Failed to load: " << path << ". Error: " << SDL_GetError() << std::endl;
+    return false;
+  }
+  SDL_RWclose(rw);
+
+  return true;
+}
+
+bool OfflineAudioSink::LoadSound(SoundEffect effect, const std::string& path, int volume) {
+  SDL_AudioSpec spec;
+  Uint8 *buffer = nullptr;
+  Uint32 length = 0;
+
+  if (nullptr == SDL_LoadWAV(path.c_str(), &spec, &buffer, &length)) {
+    std::cout << "Failed to load: " << path << ". Error: " << SDL_GetError() << std::endl;
+    return false;
+  }
+  SDL_AudioCVT cvt;
+
+  if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_S16SYS, static_cast<Uint8>(channels_), frequency_) < 0) {
+    std::cout << "Failed to convert: " << path << ". Error: " << SDL_GetError() << std::endl;
+    SDL_FreeWAV(buffer);
+    return false;
+  }
+  std::vector<Uint8> converted(length * std::max(cvt.len_mult, 1));
+
+  std::memcpy(converted.data(), buffer, length);
+  SDL_FreeWAV(buffer);
+  cvt.buf = converted.data();
+  cvt.len = static_cast<int>(length);
+  if (cvt.needed && SDL_ConvertAudio(&cvt) != 0) {
+    std::cout << "Failed to convert: " << path << ". Error: " << SDL_GetError() << std::endl;
+    return false;
+  }
+  const size_t bytes = cvt.needed ? static_cast<size_t>(cvt.len_cvt) : length;
+  std::vector<Sint16> samples(bytes / sizeof(Sint16));
+
+  std::memcpy(samples.data(), converted.data(), samples.size() * sizeof(Sint16));
+  AddSound(effect, BaseName(path), std::move(samples), volume);
+
+  return true;
+}
+
+void OfflineAudioSink::AddSound(SoundEffect effect, const std::string& name, std::vector<Sint16> samples, int volume) {
+  auto& sound = sounds_.at(effect);
+
+  sound.name = name;
+  sound.samples = std::move(samples);
+  for (auto& sample : sound.samples) {
+    sample = static_cast<Sint16>((sample * volume) / MIX_MAX_VOLUME);
+  }
+}
+
+bool OfflineAudioSink::Play(int voice, SoundEffect effect, int volume, int time_in_ms) {
+  const size_t length = sounds_.at(effect).samples.size() / channels_;
+  const size_t limit = (time_in_ms < 0) ? length : static_cast<size_t>(time_in_ms) * frequency_ / 1000;
+
+  voices_.at(voice) = { true, effect, volume, 0, std::min(length, limit) };
+  Log("play", sounds_[effect].name, voice, volume);
+
+  return true;
+}
+
+void OfflineAudioSink::SetVolume(int voice, int volume) {
+  voices_.at(voice).volume = volume;
+  Log("volume", sounds_[voices_[voice].effect].name, voice, volume);
+}
+
+void OfflineAudioSink::Halt(int voice) {
+  for (int v = 0; v < static_cast<int>(voices_.size()); ++v) {
+    if ((voice == -1 || v == voice) && voices_[v].active) {
+      voices_[v].active = false;
+      Log("halt", sounds_[voices_[v].effect].name, v, 0);
+    }
+  }
+}
+
+Uint32 OfflineAudioSink::GetTicks() const {
+  return static_cast<Uint32>((static_cast<Uint64>(rendered_frames_) * 1000) / frequency_);
+}
+
+void OfflineAudioSink::AdvanceTime(double seconds) {
+  elapsed_ += seconds;
+
+  const auto target = static_cast<size_t>(std::llround(elapsed_ * frequency_));
+
+  if (target > rendered_frames_) {
+    Render(target - rendered_frames_);
+  }
+}
+
+void OfflineAudioSink::Log(const char *event, const std::string& sound, int voice, int volume) {
+  events_ += std::to_string(GetTicks()) + "," + event + "," + sound + "," + std::to_string(voice) + "," + std::to_string(volume) + "\n";
+}
+
+void OfflineAudioSink::Render(size_t frames) {
+  mix_.assign(frames * channels_, 0);
+  for (auto& voice : voices_) {
+    if (!voice.active) {
+      continue;
+    }
+    const auto& samples = sounds_[voice.effect].samples;
+    const size_t n = std::min(frames, voice.end - voice.position);
+
+    for (size_t i = 0; i < n * channels_; ++i) {
+      mix_[i] += (samples[voice.position * channels_ + i] * voice.volume) / MIX_MAX_VOLUME;
+    }
+    voice.position += n;
+    voice.active = voice.position < voice.end;
+  }
+  for (auto sample : mix_) {
+    output_.push_back(static_cast<Sint16>(std::clamp(sample, -32768, 32767)));
+  }
+  rendered_frames_ += frames;
+}
+
+void OfflineAudioSink::Write() const {
+  std::ofstream fs(output_file_, std::ios::binary);
+  const Uint32 data_size = static_cast<Uint32>(output_.size() * sizeof(Sint16));
+
+  fs.write("RIFF", 4);
+  WriteLE<Uint32>(fs, 36 + data_size);
+  fs.write("WAVEfmt ", 8);
+  WriteLE<Uint32>(fs, 16);
+  WriteLE<Uint16>(fs, 1);
+  WriteLE<Uint16>(fs, static_cast<Uint16>(channels_));
+  WriteLE<Uint32>(fs, static_cast<Uint32>(frequency_));
+  WriteLE<Uint32>(fs, static_cast<Uint32>(frequency_ * channels_ * sizeof(Sint16)));
+  WriteLE<Uint16>(fs, static_cast<Uint16>(channels_ * sizeof(Sint16)));
+  WriteLE<Uint16>(fs, 16);
+  fs.write("data", 4);
+  WriteLE<Uint32>(fs, data_size);
+  for (auto sample : output_) {
+    WriteLE<Uint16>(fs, static_cast<Uint16>(sample));
+  }
+  std::ofstream events(EventsFile(output_file_));
+
+  events << events_;
+}
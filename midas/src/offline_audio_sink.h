@@ -0,0 +1,75 @@
+#pragma once
+
+#include "audio_sink.h"
+
+#include <vector>
+
+// Mixes into memory on a virtual clock advanced by AdvanceTime, so a run
+// produces the same output however fast it executes. When destroyed the mix
+// is written to AudioConfig::output_file and every sink call to a csv file
+// next to it (time_ms,event,sound,voice,volume). Music is only logged.
+class OfflineAudioSink final : public AudioSink {
+ public:
+  OfflineAudioSink(const AudioConfig& config, int voices);
+
+  OfflineAudioSink(const OfflineAudioSink&) = delete;
+
+  virtual ~OfflineAudioSink() noexcept;
+
+  virtual bool LoadMusic(const std::string& path, int volume) override;
+
+  virtual bool LoadSound(SoundEffect effect, const std::string& path, int volume) override;
+
+  // Sets the samples of an effect, already in the format of the mix
+  void AddSound(SoundEffect effect, const std::string& name, std::vector<Sint16> samples, int volume);
+
+  virtual bool Play(int voice, SoundEffect effect, int volume, int time_in_ms) override;
+
+  virtual bool IsPlaying(int voice) const override { return voices_.at(voice).active; }
+
+  virtual void SetVolume(int voice, int volume) override;
+
+  virtual void Halt(int voice) override;
+
+  virtual void PlayMusic(int fade_in_ms) override { Log("music-play", "", -1, fade_in_ms); }
+
+  virtual void FadeoutMusic(int ms) override { Log("music-fadeout", "", -1, ms); }
+
+  virtual void StopMusic() override { Log("music-stop", "", -1, 0); }
+
+  virtual Uint32 GetTicks() const override;
+
+  virtual void AdvanceTime(double seconds) override;
+
+ protected:
+  void Log(const char *event, const std::string& sound, int voice, int volume);
+
+  void Render(size_t frames);
+
+  void Write() const;
+
+ private:
+  struct Sound {
+    std::string name;
+    std::vector<Sint16> samples;
+  };
+
+  struct Voice {
+    bool active = false;
+    int effect = 0;
+    int volume = 0;
+    size_t position = 0;
+    size_t end = 0;
+  };
+
+  int frequency_;
+  int channels_;
+  std::string output_file_;
+  std::vector<Sound> sounds_;
+  std::vector<Voice> voices_;
+  double elapsed_ = 0.0;
+  size_t rendered_frames_ = 0;
+  std::vector<int> mix_;
+  std::vector<Sint16> output_;
+  std::string events_;
+};
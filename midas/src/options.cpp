@@ -0,0 +1,231 @@
+#include "options.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const std::string kConfigFile("midas.cfg");
+
+void PrintUsage() {
+  std::cout << "Usage: midas [options]\n"
+            << "  --audio-frequency=<hz>      Mixer sample rate\n"
+            << "  --audio-channels=<n>        Mixer output channels\n"
+            << "  --audio-buffer=<frames>     Sample frames per mixer callback\n"
+            << "  --measure-audio-latency     Report the delay from PlaySound to the mixer\n"
+            << "  --audio-backend=<backend>   sdl (default), null or offline\n"
+            << "  --audio-output=<file>       WAV file written by the offline backend\n"
+            << "  --measure-startup[=<file>]  Time each initialisation stage, write a JSON report and exit\n"
+            << "  --sdl-subsystems=<set>      everything (default) or minimal, the subsystems SDL_Init starts\n"
+            << "  --hint=<mode>               best (default), random or least-obvious, the move shown as a hint\n"
+            << "  --practice                  U takes back the last move, the score goes back with it\n"
+            << "  --session[=<file>]          Resume the game saved in the file and save it there on quit\n"
+            << "  --autoplay                  Let the Monte Carlo player make the moves\n"
+            << "  --autoplay-budget=<ms>      Search time per move, default 100\n"
+            << "  --autoplay-threads=<n>      Rollout threads, default one per core\n"
+            << "  --autoplay-depth=<n>        Moves per rollout, default 3\n"
+            << "  --autoplay-policy=<policy>  greedy (default) or random, how rollouts pick their moves\n"
+            << "  --autoplay-games=<n>        Play n games without a window, print the score distribution and exit\n"
+            << "  --autoplay-moves=<n>        Moves per game played by --autoplay-games, default 50\n"
+            << "  --seed=<n>                  Start every game from the same board\n"
+            << "  --benchmark[=<frames>]      Let the best hint play a seeded game without frame cap, print frame statistics and exit\n"
+            << "  --benchmark-speed=<n>       Game seconds per 60 benchmark frames, default 4\n"
+            << "  --metrics-overlay           Show the metrics of the last frame, F3 toggles the overlay\n"
+            << "  --metrics-log[=<file>]      Append the metrics per frame to a CSV file\n"
+            << "  --metrics-interval=<s>      Seconds per line of the metrics log, default 1\n"
+            << "  --board-pool=<n>            Starting boards made ahead of time on a thread of their own, default 2\n"
+            << "  --max-fps=<n>               Frame rate cap, default 60, 0 for none. Idle jobs run in the time left of a frame\n"
+            << "  --time-scale=<x>            Game seconds per real second, default 1, e.g. 4 plays an autoplay game four times as fast\n"
+            << "Options can also be set in " << kConfigFile << " as key=value lines" << std::endl;
+}
+
+bool ToInt(const std::string& key, const std::string& value, int min_value, int& result) {
+  try {
+    size_t pos = 0;
+    int v = std::stoi(value, &pos);
+
+    if (pos == value.size() && v >= min_value) {
+      result = v;
+      return true;
+    }
+  } catch (const std::exception&) {}
+  std::cout << "Invalid value for " << key << ": " << value << std::endl;
+
+  return false;
+}
+
+bool ToDouble(const std::string& key, const std::string& value, double min_value, double& result) {
+  try {
+    size_t pos = 0;
+    double v = std::stod(value, &pos);
+
+    if (pos == value.size() && v > min_value) {
+      result = v;
+      return true;
+    }
+  } catch (const std::exception&) {}
+  std::cout << "Invalid value for " << key << ": " << value << std::endl;
+
+  return false;
+}
+
+bool SetOption(Options& options, const std::string& key, const std::string& value) {
+  if (key == "audio-frequency") {
+    return ToInt(key, value, 8000, options.audio.frequency);
+  } else if (key == "audio-channels") {
+    return ToInt(key, value, 1, options.audio.channels);
+  } else if (key == "audio-buffer") {
+    return ToInt(key, value, 64, options.audio.buffer_size);
+  } else if (key == "audio-backend") {
+    if (value == "sdl") {
+      options.audio.backend = AudioBackend::SdlMixer;
+    } else if (value == "null") {
+      options.audio.backend = AudioBackend::Null;
+    } else if (value == "offline") {
+      options.audio.backend = AudioBackend::Offline;
+    } else {
+      std::cout << "Invalid value for " << key << ": " << value << std::endl;
+      return false;
+    }
+    return true;
+  } else if (key == "audio-output") {
+    options.audio.output_file = value;
+    return true;
+  } else if (key == "measure-startup") {
+    options.startup_report = (value == "1") ? "midas-startup.json" : value;
+    return true;
+  } else if (key == "sdl-subsystems") {
+    if (value != "everything" && value != "minimal") {
+      std::cout << "Invalid value for " << key << ": " << value << std::endl;
+      return false;
+    }
+    options.minimal_sdl_init = (value == "minimal");
+    return true;
+  } else if (key == "hint") {
+    if (value == "best") {
+      options.hint = HintMode::Best;
+    } else if (value == "random") {
+      options.hint = HintMode::Random;
+    } else if (value == "least-obvious") {
+      options.hint = HintMode::LeastObvious;
+    } else {
+      std::cout << "Invalid value for " << key << ": " << value << std::endl;
+      return false;
+    }
+    return true;
+  } else if (key == "practice") {
+    options.practice = (value != "0" && value != "false");
+    return true;
+  } else if (key == "session") {
+    options.session = (value == "1") ? "midas-session.bin" : value;
+    return true;
+  } else if (key == "autoplay") {
+    options.autoplay = (value != "0" && value != "false");
+    return true;
+  } else if (key == "autoplay-budget") {
+    int ms = 0;
+
+    if (!ToInt(key, value, 1, ms)) {
+      return false;
+    }
+    options.autoplay_config.budget = std::chrono::milliseconds(ms);
+    return true;
+  } else if (key == "autoplay-threads") {
+    return ToInt(key, value, 1, options.autoplay_config.threads);
+  } else if (key == "autoplay-depth") {
+    return ToInt(key, value, 1, options.autoplay_config.depth);
+  } else if (key == "autoplay-policy") {
+    if (value == "greedy") {
+      options.autoplay_config.policy = RolloutPolicy::Greedy;
+    } else if (value == "random") {
+      options.autoplay_config.policy = RolloutPolicy::Random;
+    } else {
+      std::cout << "Invalid value for " << key << ": " << value << std::endl;
+      return false;
+    }
+    return true;
+  } else if (key == "autoplay-games") {
+    return ToInt(key, value, 1, options.autoplay_games);
+  } else if (key == "autoplay-moves") {
+    return ToInt(key, value, 1, options.autoplay_moves);
+  } else if (key == "seed") {
+    return ToInt(key, value, 1, options.seed);
+  } else if (key == "benchmark") {
+    if (value == "1") {
+      options.benchmark_frames = 0; // A bare --benchmark plays a whole game
+      return true;
+    }
+    return ToInt(key, value, 1, options.benchmark_frames);
+  } else if (key == "benchmark-speed") {
+    return ToInt(key, value, 1, options.benchmark_speed);
+  } else if (key == "metrics-overlay") {
+    options.metrics_overlay = (value != "0" && value != "false");
+    return true;
+  } else if (key == "metrics-log") {
+    options.metrics_log = (value == "1") ? "midas-metrics.csv" : value;
+    return true;
+  } else if (key == "metrics-interval") {
+    return ToInt(key, value, 1, options.metrics_interval);
+  } else if (key == "board-pool") {
+    return ToInt(key, value, 0, options.board_pool);
+  } else if (key == "max-fps") {
+    return ToInt(key, value, 0, options.max_fps);
+  } else if (key == "time-scale") {
+    return ToDouble(key, value, 0.0, options.time_scale);
+  } else if (key == "measure-audio-latency") {
+    options.audio.measure_latency = (value != "0" && value != "false");
+    return true;
+  }
+  std::cout << "Unknown option: " << key << std::endl;
+
+  return false;
+}
+
+std::string Trim(const std::string& s) {
+  const auto first = s.find_first_not_of(" \t\r");
+
+  if (first == std::string::npos) {
+    return "";
+  }
+  return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+std::pair<std::string, std::string> SplitOption(const std::string& option) {
+  const auto pos = option.find('=');
+
+  if (pos == std::string::npos) {
+    return std::make_pair(Trim(option), std::string("1"));
+  }
+  return std::make_pair(Trim(option.substr(0, pos)), Trim(option.substr(pos + 1)));
+}
+
+}
+
+Options ParseOptions(int argc, char *argv[]) {
+  Options options;
+  std::ifstream fs(kConfigFile);
+
+  for (std::string line; std::getline(fs, line);) {
+    line = Trim(line.substr(0, line.find('#')));
+    if (!line.empty()) {
+      auto [key, value] = SplitOption(line);
+
+      SetOption(options, key, value);
+    }
+  }
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+
+    if (arg.compare(0, 2, "--") != 0 || arg == "--help") {
+      PrintUsage();
+      exit((arg == "--help") ? 0 : -1);
+    }
+    auto [key, value] = SplitOption(arg.substr(2));
+
+    if (!SetOption(options, key, value)) {
+      PrintUsage();
+      exit(-1);
+    }
+  }
+  return options;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "audio.h"
+#include "autoplay.h"
+
+#include <string>
+
+struct Options {
+  AudioConfig audio;
+  std::string startup_report; // Empty unless --measure-startup is given
+  std::string session; // Empty unless --session is given
+  bool minimal_sdl_init = false;
+  HintMode hint = HintMode::Best;
+  bool practice = false; // Moves can be taken back
+  bool autoplay = false;
+  int autoplay_games = 0; // Headless games to play instead of starting the game
+  int autoplay_moves = 50; // Moves per headless game
+  AutoplayConfig autoplay_config;
+  int seed = 0; // 0 gives a new board every game
+  int benchmark_frames = -1; // -1 unless --benchmark is given, 0 plays until the game is over
+  int benchmark_speed = 4; // Game seconds per kFPS frames
+  bool metrics_overlay = false;
+  std::string metrics_log; // Empty unless --metrics-log is given
+  int metrics_interval = 1; // Seconds per line of the metrics log
+  int board_pool = 2; // Starting boards made ahead of time, 0 makes them when needed
+  int max_fps = 60; // 0 leaves the frame rate uncapped and no slack for the idle jobs
+  double time_scale = 1.0; // Game seconds per real second
+};
+
+// Reads midas.cfg from the working directory, if present, and then the
+// command line. Both use the same keys, e.g. audio-buffer=256 in the file
+// and --audio-buffer=256 on the command line.
+Options ParseOptions(int argc, char *argv[]);
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "constants.h"
+#include "sprite.h"
+
+#include <array>
+#include <cstdint>
+#include <random>
+
+// xoshiro128** 1.1 by David Blackman and Sebastiano Vigna, a small and fast
+// generator with 128 bits of state (http://prng.di.unimi.it/)
+class Xoshiro128 final {
+ public:
+  using result_type = uint32_t;
+  using State = std::array<uint32_t, 4>;
+
+  explicit Xoshiro128(uint64_t seed) { Seed(seed); }
+
+  // The state is filled from splitmix64 so any seed, 0 included, works
+  void Seed(uint64_t seed) {
+    for (auto& s : state_) {
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      s = static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+    }
+  }
+
+  const State& GetState() const { return state_; }
+
+  void SetState(const State& state) { state_ = state; }
+
+  static constexpr result_type min() { return 0; }
+
+  static constexpr result_type max() { return UINT32_MAX; }
+
+  result_type operator()() {
+    const uint32_t result = Rotl(state_[1] * 5, 7) * 9;
+    const uint32_t t = state_[1] << 9;
+
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = Rotl(state_[3], 11);
+
+    return result;
+  }
+
+ protected:
+  static uint32_t Rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+ private:
+  State state_;
+};
+
+namespace {
+  const uint32_t kAllColours = (1u << kNumSprites) - 1;
+
+  constexpr std::array<uint8_t, kAllColours + 1> CountColours() {
+    std::array<uint8_t, kAllColours + 1> count {};
+
+    for (uint32_t mask = 0; mask <= kAllColours; ++mask) {
+      for (uint32_t id = 0; id < kNumSprites; ++id) {
+        count[mask] += (mask >> id) & 1;
+      }
+    }
+    return count;
+  }
+
+  // The allowed colours of every mask, in order, so picking the nth allowed
+  // colour is a table lookup
+  constexpr std::array<std::array<uint8_t, kNumSprites>, kAllColours + 1> ListColours() {
+    std::array<std::array<uint8_t, kNumSprites>, kAllColours + 1> colours {};
+
+    for (uint32_t mask = 0; mask <= kAllColours; ++mask) {
+      uint32_t n = 0;
+
+      for (uint32_t id = 0; id < kNumSprites; ++id) {
+        if ((mask >> id) & 1) {
+          colours[mask][n++] = static_cast<uint8_t>(id);
+        }
+      }
+    }
+    return colours;
+  }
+
+  constexpr auto kColourCount = CountColours();
+  constexpr auto kNthColour = ListColours();
+}
+
+// Draws the pieces of a Grid. A constrained draw picks directly among the
+// allowed colours instead of retrying until it gets one, which gives the same
+// uniform distribution over the allowed colours as rejection sampling did.
+class PieceGenerator final {
+ public:
+  PieceGenerator() : PieceGenerator((static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}()) {}
+
+  explicit PieceGenerator(uint64_t seed) : engine_(seed) {}
+
+  void Seed(uint64_t seed) { engine_.Seed(seed); }
+
+  const Xoshiro128::State& GetState() const { return engine_.GetState(); }
+
+  void SetState(const Xoshiro128::State& state) { engine_.SetState(state); }
+
+  SpriteID Next() { return static_cast<SpriteID>(Uniform(kNumSprites)); }
+
+  // Any colour but not_this and nor_this, pass SpriteID::Empty to allow all
+  SpriteID NextExcept(SpriteID not_this, SpriteID nor_this) {
+    const uint32_t allowed = kAllColours & ~(1u << not_this) & ~(1u << nor_this);
+
+    return static_cast<SpriteID>(kNthColour[allowed][Uniform(kColourCount[allowed])]);
+  }
+
+ protected:
+  // Maps a 32-bit number onto [0, n) with a multiply and a shift. The bias is
+  // below n / 2^32, far too small to show up in the game.
+  uint32_t Uniform(uint32_t n) { return static_cast<uint32_t>((static_cast<uint64_t>(engine_()) * n) >> 32); }
+
+ private:
+  Xoshiro128 engine_;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+// Returns the current resident set size of the process in KiB, or 0
+// on platforms where it is not available.
+inline size_t GetResidentSetSize() {
+#if defined(__linux__)
+  std::ifstream fs("/proc/self/statm");
+  size_t pages = 0;
+  size_t resident = 0;
+
+  if (fs >> pages >> resident) {
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) / 1024;
+  }
+#endif
+  return 0;
+}
+
+// Returns the highest resident set size the process has had in KiB, or 0
+// on platforms where it is not available.
+inline size_t GetPeakResidentSetSize() {
+#if defined(__linux__)
+  std::ifstream fs("/proc/self/status");
+
+  for (std::string line; std::getline(fs, line);) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stoul(line.substr(6));
+    }
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "piece_generator.h"
+
+#include <cstdlib>
+#include <iostream>
+
+// The pieces that will drop into each column, pregenerated in batches into one
+// ring buffer per column. Every column is its own stream where a piece differs
+// from the one before it, so the next kLookahead pieces of a column are known
+// and stay the same no matter in which order the columns are refilled.
+class RefillSource final {
+ public:
+  static constexpr int kCapacity = 32;
+  static constexpr int kBatch = 16;
+  static constexpr int kLookahead = kCapacity - kBatch;
+
+  RefillSource() : RefillSource((static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}()) {}
+
+  explicit RefillSource(uint64_t seed) { Seed(seed); }
+
+  // Every column gets a generator of its own
+  void Seed(uint64_t seed) {
+    for (int col = 0; col < kCols; ++col) {
+      generators_[col].Seed(seed + col);
+    }
+    Fill();
+  }
+
+  // Everything needed to continue the streams, trivially copyable so it can
+  // go into a snapshot
+  struct State {
+    std::array<std::array<SpriteID, kCapacity>, kCols> ring;
+    std::array<int, kCols> head;
+    std::array<int, kCols> count;
+    std::array<Xoshiro128::State, kCols> generators;
+
+    // A state read from a file or passed in through the C API is only used
+    // when every ring index and piece is in range
+    bool IsValid() const {
+      for (int col = 0; col < kCols; ++col) {
+        if (head[col] < 0 || head[col] >= kCapacity || count[col] < kLookahead || count[col] > kCapacity) {
+          return false;
+        }
+        for (const auto id : ring[col]) {
+          if (static_cast<int>(id) < 0 || static_cast<int>(id) > static_cast<int>(SpriteID::Empty)) {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+  };
+
+  void GetState(State& state) const {
+    state.ring = ring_;
+    state.head = head_;
+    state.count = count_;
+    for (int col = 0; col < kCols; ++col) {
+      state.generators[col] = generators_[col].GetState();
+    }
+  }
+
+  void SetState(const State& state) {
+    ring_ = state.ring;
+    head_ = state.head;
+    count_ = state.count;
+    for (int col = 0; col < kCols; ++col) {
+      generators_[col].SetState(state.generators[col]);
+    }
+  }
+
+  // The nth upcoming piece of the column, 0 is the one Pop returns next
+  SpriteID Peek(int col, int n) const {
+    if (n < 0 || n >= kLookahead) {
+      std::cout << "Peek " << n << " is outside the lookahead of " << kLookahead << std::endl;
+      exit(-1);
+    }
+    return ring_[col][(head_[col] + n) % kCapacity];
+  }
+
+  // Generates every column up to the capacity ahead of time, so the next
+  // kBatch pops of a column do not have to
+  void TopUp() {
+    for (int col = 0; col < kCols; ++col) {
+      FillColumn(col, kCapacity - count_[col]);
+    }
+  }
+
+  SpriteID Pop(int col) {
+    const SpriteID id = ring_[col][head_[col]];
+
+    head_[col] = (head_[col] + 1) % kCapacity;
+    if (--count_[col] < kLookahead) {
+      FillColumn(col, kBatch);
+    }
+    return id;
+  }
+
+ protected:
+  void Fill() {
+    head_.fill(0);
+    count_.fill(0);
+    for (int col = 0; col < kCols; ++col) {
+      FillColumn(col, kCapacity);
+    }
+  }
+
+  void FillColumn(int col, int n) {
+    for (int i = 0; i < n; ++i, ++count_[col]) {
+      const SpriteID last = (count_[col] > 0) ? ring_[col][(head_[col] + count_[col] - 1) % kCapacity] : SpriteID::Empty;
+
+      ring_[col][(head_[col] + count_[col]) % kCapacity] = generators_[col].NextExcept(last, SpriteID::Empty);
+    }
+  }
+
+ private:
+  std::array<PieceGenerator, kCols> generators_;
+  std::array<std::array<SpriteID, kCapacity>, kCols> ring_;
+  std::array<int, kCols> head_;
+  std::array<int, kCols> count_;
+};
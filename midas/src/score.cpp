@@ -1,61 +1,12 @@
 #include "score.h"
+#include "frame_arena.h"
 
-#include <set>
 #include <fstream>
+
 namespace {
 
 const std::string kFilename("midas.shs");
 
-std::pair<int, bool> GetScoreForTotalMatches(int total_matches, int& current_threshold_step) {
-  int score = 0;
-  bool threshold_reached = false;
-
-  if (total_matches >= (current_threshold_step * kThresholdMultiplier)) {
-    score = (500 + ((current_threshold_step - kInitialThresholdStep) * 250));
-    current_threshold_step++;
-    threshold_reached = true;
-
-#if !defined(NDEBUG)
-    if (score > 0) {
-      std::cout << "GetScoreForTotalMatches: " << score << "N Jewels: " << total_matches << std::endl;
-    }
-#endif
-  }
-  return std::make_pair(score, threshold_reached);
-}
-
-int GetScoreForConsecutiveMatches(int consecutive_matches, int& previous_consecutive_matches) {
-  if (previous_consecutive_matches == consecutive_matches) {
-    return 0;
-  }
-  previous_consecutive_matches = consecutive_matches;
-
-  std::vector<int> scores = { 0, 0, 50, 100, 150, 250, 350, 500, 750 };
-
-  int score = (consecutive_matches >=9) ? 1000 : scores.at(consecutive_matches);
-
-#if !defined(NDEBUG)
-  if (score > 0) {
-    std::cout << "GetScoreForConsecutiveMatches: " << score << std::endl;
-  }
-#endif
-
-  return score;
-}
-
-std::pair<int, bool> CalculateScore(size_t matches, int& total_matches, int& current_threshold_step,
-                                    int consecutive_matches, int& previous_consecutive_matches) {
-  int score = 0;
-
-  total_matches += static_cast<int>(matches);
-  score += GetBasicScore(matches);
-  score += GetScoreForConsecutiveMatches(consecutive_matches, previous_consecutive_matches);
-
-  auto [total_score, threshold_reached] = GetScoreForTotalMatches(total_matches, current_threshold_step);
-
-  return std::make_pair(score + total_score, threshold_reached);
-}
-
 }
 
 ScoreManagement::ScoreManagement() {
@@ -81,14 +32,10 @@ void ScoreManagement::Update(const std::vector<Position>& matches, int chains) {
   if (matches.size() == 0) {
     return;
   }
-  consecutive_matches_ += chains;
-  size_t unique_matches = std::set<Position>(matches.begin(), matches.end()).size();
-
-  auto [score, threshold_reached] = CalculateScore(unique_matches, total_matches_, current_threshold_step_,
-                                                      consecutive_matches_, previous_consecutive_matches_);
+  size_t unique_matches = ArenaSet<Position>(matches.begin(), matches.end(), GetFrameArena()).size();
+  [[maybe_unused]] int score = rules_.Update(unique_matches, chains);
 
-  if (threshold_reached) {
-    threshold_reached_ = true;
-  }
-  score_ += score;
+#if !defined(NDEBUG)
+  std::cout << "Score: " << score << " Jewels: " << unique_matches << " Chains: " << chains << std::endl;
+#endif
 }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "constants.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+inline int GetBasicScore(size_t matches) {
+  const int scores[] = { 0, 0, 0, 50, 100, 150, 250, 500 };
+
+  return (matches >= 7) ? 500 : scores[matches];
+}
+
+// The scoring rules of the game without any presentation, so that headless
+// engines score a move exactly like ScoreManagement does.
+class ScoreRules final {
+ public:
+  void Reset() {
+    score_ = 0;
+    consecutive_matches_ = 0;
+    previous_consecutive_matches_ = 0;
+    total_matches_ = 0;
+    current_threshold_step_ = kInitialThresholdStep;
+    threshold_reached_ = 0;
+  }
+
+  // unique_matches is the number of distinct positions removed and chains the
+  // number of runs they form. Returns the points scored.
+  int Update(size_t unique_matches, int chains) {
+    if (unique_matches == 0) {
+      return 0;
+    }
+    consecutive_matches_ += chains;
+    total_matches_ += static_cast<int>(unique_matches);
+
+    int score = GetBasicScore(unique_matches) + GetScoreForConsecutiveMatches();
+
+    if (total_matches_ >= (current_threshold_step_ * kThresholdMultiplier)) {
+      score += 500 + ((current_threshold_step_ - kInitialThresholdStep) * 250);
+      current_threshold_step_++;
+      threshold_reached_ = 1;
+    }
+    score_ += score;
+
+    return score;
+  }
+
+  // Called when the board is stable again without any matches
+  void ResetConsecutiveMatches() {
+    consecutive_matches_ = 0;
+    previous_consecutive_matches_ = 0;
+  }
+
+  bool ThresholdReached() {
+    return std::exchange(threshold_reached_, 0) != 0;
+  }
+
+  void Decrese() { score_ = std::max(score_ - 10, 0); }
+
+  int Get() const { return score_; }
+
+  int GetTotalMatches() const { return total_matches_; }
+
+  int& GetConsecutiveMatchesRef() { return consecutive_matches_; }
+
+  int& GetPreviousConsecutiveMatchesRef() { return previous_consecutive_matches_; }
+
+  // For rules read from a file, the counters index the score tables
+  bool IsValid() const {
+    return score_ >= 0 && consecutive_matches_ >= 0 && previous_consecutive_matches_ >= 0 &&
+      previous_consecutive_matches_ <= consecutive_matches_ && total_matches_ >= 0 &&
+      current_threshold_step_ >= kInitialThresholdStep && threshold_reached_ <= 1;
+  }
+
+ protected:
+  int GetScoreForConsecutiveMatches() {
+    if (previous_consecutive_matches_ == consecutive_matches_) {
+      return 0;
+    }
+    const int scores[] = { 0, 0, 50, 100, 150, 250, 350, 500, 750 };
+
+    previous_consecutive_matches_ = consecutive_matches_;
+
+    return (consecutive_matches_ >= 9) ? 1000 : scores[consecutive_matches_];
+  }
+
+ private:
+  int score_ = 0;
+  int consecutive_matches_ = 0;
+  int previous_consecutive_matches_ = 0;
+  int total_matches_ = 0;
+  int current_threshold_step_ = kInitialThresholdStep;
+  uint8_t threshold_reached_ = 0; // Not a bool, so a snapshot can hold any byte and still be checked
+};
@@ -0,0 +1,134 @@
+#include "sdl_mixer_sink.h"
+
+#include <iostream>
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+SdlMixerSink::SdlMixerSink(const AudioConfig& config, int voices) : measure_latency_(config.measure_latency) {
+  Mix_AllocateChannels(voices);
+  sound_effects_.resize(HurryUp + 1);
+  requested_at_ = std::make_unique<std::atomic<Uint64>[]>(voices);
+  created_ = SDL_GetTicks();
+  Mix_SetPostMix(&SdlMixerSink::PostMix, this);
+
+  int frequency = 0;
+  Uint16 format = 0;
+  int channels = 0;
+
+  if (Mix_QuerySpec(&frequency, &format, &channels) != 0 && frequency > 0) {
+    buffer_ms_ = (config.buffer_size * 1000.0) / frequency;
+    if (measure_latency_) {
+      std::cout << "Audio device: " << frequency << " Hz, " << channels << " channels, "
+                << config.buffer_size << " frames per buffer (" << buffer_ms_ << " ms)" << std::endl;
+    }
+  }
+}
+
+SdlMixerSink::~SdlMixerSink() noexcept {
+  Mix_SetPostMix(nullptr, nullptr);
+  StopMusic();
+  Mix_HaltChannel(-1);
+}
+
+bool SdlMixerSink::LoadMusic(const std::string& path, int volume) {
+#if defined(MIDAS_BUILTIN_MUSIC_DECODER)
+  music_ = std::make_unique<MusicStream>(path);
+
+  if (!music_->IsOpen()) {
+    return false;
+  }
+  music_->SetVolume(volume);
+#else
+  music_ = UniqueMusicPtr{ Mix_LoadMUS(path.c_str()) };
+
+  if (nullptr == music_) {
+    std::cout << "Failed to load: " << path << ". Error: " << Mix_GetError() << std::endl;
+    return false;
+  }
+  Mix_VolumeMusic(volume);
+#endif
+  return true;
+}
+
+bool SdlMixerSink::LoadSound(SoundEffect effect, const std::string& path, int volume) {
+  // Mix_LoadWAV converts the samples to the device format once, here,
+  // so nothing is resampled when the effect is played.
+  auto chunk = UniqueChunkPtr{ Mix_LoadWAV(path.c_str()) };
+
+  if (nullptr == chunk) {
+    std::cout << "Failed to load: " << path << ". Error: " << Mix_GetError() << std::endl;
+    return false;
+  }
+  Mix_VolumeChunk(chunk.get(), volume);
+  sound_effects_.at(effect) = std::move(chunk);
+
+  return true;
+}
+
+bool SdlMixerSink::Play(int voice, SoundEffect effect, int volume, int time_in_ms) {
+  Mix_Volume(voice, volume);
+  if (measure_latency_) {
+    // The probe has to be in place before the mixer can pick the chunk up,
+    // or the first buffer is missed. Starting a voice that still plays drops
+    // its effects, so it is halted before the probe is registered.
+    if (Mix_Playing(voice)) {
+      Mix_HaltChannel(voice);
+    }
+    requested_at_[voice] = SDL_GetPerformanceCounter();
+    // SDL_mixer removes the effect when the channel is done playing
+    Mix_RegisterEffect(voice, &SdlMixerSink::LatencyProbe, nullptr, this);
+  }
+  if (Mix_PlayChannelTimed(voice, sound_effects_.at(effect).get(), 0, time_in_ms) == -1) {
+    if (measure_latency_) {
+      requested_at_[voice] = 0;
+      Mix_UnregisterEffect(voice, &SdlMixerSink::LatencyProbe);
+    }
+    return false;
+  }
+  return true;
+}
+
+void SdlMixerSink::GetStatistics(AudioStatistics& statistics) const {
+  if (const Uint32 elapsed_ms = SDL_GetTicks() - created_; elapsed_ms > 0) {
+    statistics.mixer_load = static_cast<double>(mixer_cpu_ns_) / (elapsed_ms * 1000000.0);
+  }
+  statistics.latency_samples = latency_samples_;
+  if (statistics.latency_samples > 0) {
+    const double ticks_per_ms = SDL_GetPerformanceFrequency() / 1000.0;
+
+    statistics.average_latency_ms = buffer_ms_ + (latency_total_ / ticks_per_ms) / statistics.latency_samples;
+    statistics.max_latency_ms = buffer_ms_ + latency_max_ / ticks_per_ms;
+  }
+}
+
+void SdlMixerSink::PostMix(void *udata, Uint8 *, int) {
+#if defined(__linux__)
+  // Runs last on the mixer thread, so the thread's cpu time covers all mixing
+  timespec ts;
+
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+    static_cast<SdlMixerSink*>(udata)->mixer_cpu_ns_ = static_cast<long long>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+#else
+  (void)udata;
+#endif
+}
+
+void SdlMixerSink::LatencyProbe(int channel, void *, int, void *udata) {
+  // Called on the mixer thread for every buffer the channel is mixed into,
+  // the first call is the one that starts the chunk. The buffer is then
+  // queued behind the one playing, which GetStatistics accounts for.
+  auto sink = static_cast<SdlMixerSink*>(udata);
+  const Uint64 requested_at = sink->requested_at_[channel].exchange(0);
+
+  if (requested_at == 0) {
+    return;
+  }
+  const Uint64 delay = SDL_GetPerformanceCounter() - requested_at;
+
+  sink->latency_total_ += delay;
+  sink->latency_samples_++;
+  for (Uint64 max = sink->latency_max_; delay > max && !sink->latency_max_.compare_exchange_weak(max, delay);) {}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "audio_sink.h"
+#include "function_caller.h"
+#include "music_stream.h"
+
+#include <atomic>
+#include <vector>
+
+// Plays through the audio device opened with Mix_OpenAudio, one mixer
+// channel per voice.
+class SdlMixerSink final : public AudioSink {
+ public:
+  SdlMixerSink(const AudioConfig& config, int voices);
+
+  SdlMixerSink(const SdlMixerSink&) = delete;
+
+  virtual ~SdlMixerSink() noexcept;
+
+  virtual bool LoadMusic(const std::string& path, int volume) override;
+
+  virtual bool LoadSound(SoundEffect effect, const std::string& path, int volume) override;
+
+  virtual bool Play(int voice, SoundEffect effect, int volume, int time_in_ms) override;
+
+  virtual bool IsPlaying(int voice) const override { return Mix_Playing(voice) != 0; }
+
+  virtual void SetVolume(int voice, int volume) override { Mix_Volume(voice, volume); }
+
+  virtual void Halt(int voice) override { Mix_HaltChannel(voice); }
+
+#if defined(MIDAS_BUILTIN_MUSIC_DECODER)
+  virtual void PlayMusic(int fade_in_ms) override { music_->Play(fade_in_ms); }
+
+  virtual void FadeoutMusic(int ms) override { music_->FadeOut(ms); }
+
+  virtual void StopMusic() override { music_->Stop(); }
+#else
+  virtual void PlayMusic(int fade_in_ms) override {
+    Mix_HaltMusic();
+    Mix_RewindMusic();
+    Mix_FadeInMusic(music_.get(), -1, fade_in_ms);
+  }
+
+  virtual void FadeoutMusic(int ms) override { Mix_FadeOutMusic(ms); }
+
+  virtual void StopMusic() override { Mix_HaltMusic(); }
+#endif
+
+  virtual void GetStatistics(AudioStatistics& statistics) const override;
+
+ protected:
+  static void PostMix(void *udata, Uint8 *stream, int len);
+
+  static void LatencyProbe(int channel, void *stream, int len, void *udata);
+
+ private:
+  using UniqueMusicPtr = std::unique_ptr<Mix_Music, function_caller<void(Mix_Music*), &Mix_FreeMusic>>;
+  using UniqueChunkPtr = std::unique_ptr<Mix_Chunk, function_caller<void(Mix_Chunk*), &Mix_FreeChunk>>;
+
+#if defined(MIDAS_BUILTIN_MUSIC_DECODER)
+  std::unique_ptr<MusicStream> music_;
+#else
+  UniqueMusicPtr music_;
+#endif
+  std::vector<UniqueChunkPtr> sound_effects_;
+  Uint32 created_ = 0;
+  std::atomic<long long> mixer_cpu_ns_ { 0 };
+  bool measure_latency_ = false;
+  double buffer_ms_ = 0.0;
+  std::unique_ptr<std::atomic<Uint64>[]> requested_at_;
+  std::atomic<int> latency_samples_ { 0 };
+  std::atomic<Uint64> latency_total_ { 0 };
+  std::atomic<Uint64> latency_max_ { 0 };
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "grid.h"
+#include "score_rules.h"
+
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+const uint32_t kSnapshotMagic = 0x5344494d; // "MIDS"
+const uint32_t kSnapshotVersion = 1;
+
+// The complete state of a game. It is trivially copyable, so cloning a
+// position is a copy of about 1.4 KiB, and it is written to disk as it is.
+// A file can only be read back by a build with the same layout, which the
+// header checks, and the grid and score in it have to be in range.
+struct GameSnapshot {
+  uint32_t magic = kSnapshotMagic;
+  uint32_t version = kSnapshotVersion;
+  uint32_t size = sizeof(GameSnapshot);
+  GridSnapshot grid;
+  ScoreRules score;
+  int elapsed_time = 0; // Seconds of the game time used
+
+  bool IsValid() const {
+    return magic == kSnapshotMagic && version == kSnapshotVersion && size == sizeof(GameSnapshot) &&
+      grid.IsValid() && score.IsValid() && elapsed_time >= 0;
+  }
+};
+
+static_assert(std::is_trivially_copyable<GameSnapshot>::value, "GameSnapshot must be copyable with memcpy");
+
+inline bool WriteSnapshot(const std::string& file, const GameSnapshot& snapshot) {
+  std::ofstream fs(file, std::ios::binary | std::ios::trunc);
+
+  fs.write(reinterpret_cast<const char *>(&snapshot), sizeof(snapshot));
+
+  return fs.good();
+}
+
+inline bool ReadSnapshot(const std::string& file, GameSnapshot& snapshot) {
+  std::ifstream fs(file, std::ios::binary);
+  GameSnapshot s;
+
+  if (!fs.read(reinterpret_cast<char *>(&s), sizeof(s)) || !s.IsValid()) {
+    return false;
+  }
+  snapshot = s;
+
+  return true;
+}
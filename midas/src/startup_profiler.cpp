@@ -0,0 +1,47 @@
+#include "startup_profiler.h"
+#include "process_stats.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+std::string Escape(const std::string& s) {
+  std::string escaped;
+
+  for (auto c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+}
+
+bool StartupProfiler::WriteReport() {
+  const double total_ms = ToMs(Clock::now());
+  std::ofstream fs(report_file_);
+
+  enabled_ = false;
+  if (!fs) {
+    std::cout << "Failed to write startup report " << report_file_ << std::endl;
+    return false;
+  }
+  fs << "{\n  \"total_ms\": " << total_ms << ",\n  \"resident_kib\": " << GetResidentSetSize() << ",\n";
+  for (const auto& [key, value] : annotations_) {
+    fs << "  \"" << Escape(key) << "\": \"" << Escape(value) << "\",\n";
+  }
+  fs << "  \"stages\": [\n";
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    const auto& stage = stages_[i];
+
+    fs << "    { \"name\": \"" << Escape(stage.name) << "\", \"start_ms\": " << stage.start_ms
+       << ", \"duration_ms\": " << stage.duration_ms << " }" << ((i + 1 < stages_.size()) ? ",\n" : "\n");
+  }
+  fs << "  ]\n}\n";
+  std::cout << "Startup took " << total_ms << " ms, report written to " << report_file_ << std::endl;
+
+  return true;
+}
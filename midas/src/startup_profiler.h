@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Records how long each initialisation stage takes when the game is started
+// with --measure-startup. Stages are timed with a StartupStage on the stack;
+// when the profiler is disabled they cost a single branch.
+class StartupProfiler final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static StartupProfiler& Get() {
+    static StartupProfiler profiler;
+
+    return profiler;
+  }
+
+  bool IsEnabled() const { return enabled_; }
+
+  void Enable(const std::string& report_file) {
+    enabled_ = true;
+    report_file_ = report_file;
+  }
+
+  void Record(const std::string& stage, Clock::time_point start, Clock::time_point end) {
+    stages_.push_back({ stage, ToMs(start), ToMs(end) - ToMs(start) });
+  }
+
+  void Annotate(const std::string& key, const std::string& value) { annotations_.emplace_back(key, value); }
+
+  // Writes the report as JSON and disables the profiler
+  bool WriteReport();
+
+ protected:
+  StartupProfiler() : started_(Clock::now()) {}
+
+  double ToMs(Clock::time_point t) const { return std::chrono::duration<double, std::milli>(t - started_).count(); }
+
+ private:
+  struct Stage {
+    std::string name;
+    double start_ms;
+    double duration_ms;
+  };
+
+  bool enabled_ = false;
+  std::string report_file_;
+  Clock::time_point started_;
+  std::vector<Stage> stages_;
+  std::vector<std::pair<std::string, std::string>> annotations_;
+};
+
+class StartupStage final {
+ public:
+  explicit StartupStage(const char *name) : name_(StartupProfiler::Get().IsEnabled() ? name : nullptr) {
+    if (nullptr != name_) {
+      start_ = StartupProfiler::Clock::now();
+    }
+  }
+
+  StartupStage(const StartupStage&) = delete;
+
+  ~StartupStage() {
+    if (nullptr != name_) {
+      StartupProfiler::Get().Record(name_, start_, StartupProfiler::Clock::now());
+    }
+  }
+
+ private:
+  const char *name_;
+  StartupProfiler::Clock::time_point start_;
+};
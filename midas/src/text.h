@@ -1,5 +1,6 @@
 #pragma once
 
+#include "draw_calls.h"
 #include "function_caller.h"
 
 #include <tuple>
@@ -11,7 +12,7 @@
 
 enum class Color { White, Blue, Red, Green, Black, Yellow, Cyan };
 
-using UniqueTexturePtr = std::unique_ptr<SDL_Texture, function_caller<void(SDL_Texture*), &SDL_DestroyTexture>>;
+using UniqueTexturePtr = std::unique_ptr<SDL_Texture, function_caller<void(SDL_Texture*), &CountedDestroyTexture>>;
 
 void RenderText(SDL_Renderer *renderer, int x, int y, TTF_Font *font, const std::string& text,
                 Color text_color);
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads with a task queue each. A worker takes tasks
+// from the back of its own queue and, when that is empty, steals from the
+// front of the others, so tasks of uneven length (a rollout that cascades a
+// lot) do not leave threads idle while one queue still holds work.
+class WorkStealingPool final {
+ public:
+  using Task = std::function<void(int task, int worker)>;
+
+  explicit WorkStealingPool(int threads) : queues_(std::max(threads, 1)) {
+    for (int worker = 0; worker < size(); ++worker) {
+      workers_.emplace_back([this, worker] { Work(worker); });
+    }
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  int size() const { return static_cast<int>(queues_.size()); }
+
+  uint64_t GetSteals() const { return steals_; }
+
+  // Calls task(0, worker) ... task(tasks - 1, worker) on the workers and
+  // returns when all of them are done. One Run at a time.
+  void Run(int tasks, const Task& task) {
+    if (tasks <= 0) {
+      return;
+    }
+    task_ = &task;
+    pending_ = tasks;
+    for (int i = 0; i < tasks; ++i) {
+      auto& queue = queues_[i % size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+
+      queue.tasks.push_back(i);
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Added, not assigned, as a worker that was still awake may already have
+    // taken one of the tasks
+    queued_ += tasks;
+    wake_.notify_all();
+    done_.wait(lock, [this] { return pending_ == 0; });
+  }
+
+ protected:
+  bool Pop(int worker, int& task) {
+    auto& queue = queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty()) {
+      return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+
+    return true;
+  }
+
+  bool Steal(int worker, int& task) {
+    for (int i = 1; i < size(); ++i) {
+      auto& queue = queues_[(worker + i) % size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+
+      if (!queue.tasks.empty()) {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        steals_++;
+
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Work(int worker) {
+    for (;;) {
+      int task;
+
+      if (Pop(worker, task) || Steal(worker, task)) {
+        queued_--;
+        (*task_)(task, worker);
+        if (--pending_ == 0) {
+          std::lock_guard<std::mutex> lock(mutex_);
+
+          done_.notify_all();
+        }
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+      if (stop_) {
+        return;
+      }
+    }
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<int> tasks;
+  };
+
+  std::vector<Queue> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  bool stop_ = false;
+  const Task *task_ = nullptr;
+  std::atomic<int> queued_ { 0 };
+  std::atomic<int> pending_ { 0 };
+  std::atomic<uint64_t> steals_ { 0 };
+};
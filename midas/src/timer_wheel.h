@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Every deadline of the game on one clock. The game time only moves when
+// Advance is called, once a frame with the time the frame took, and a
+// callback runs when its deadline has passed, so nothing reads the clock to
+// find out whether it is due. The timers hash into a wheel of slots by their
+// deadline and an advance only looks at the slots it passes. The game time
+// can be paused and scaled, e.g. to play a headless game faster than real
+// time.
+class TimerWheel final {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = std::chrono::microseconds;
+  using Callback = std::function<void()>;
+
+  static constexpr Duration kTick = std::chrono::milliseconds(10);
+  static constexpr size_t kSlots = 256; // A revolution is 2.56 s
+
+  // Cancels the timer when it goes out of scope, so a callback never
+  // outlives the object it was set up by
+  class Timer final {
+   public:
+    Timer() = default;
+    Timer(TimerWheel *wheel, uint64_t id) : wheel_(wheel), id_(id) {}
+    Timer(const Timer&) = delete;
+    Timer(Timer&& other) noexcept : wheel_(other.wheel_), id_(other.id_) { other.wheel_ = nullptr; }
+
+    Timer& operator=(Timer&& other) noexcept {
+      if (this != &other) {
+        Cancel();
+        wheel_ = other.wheel_;
+        id_ = other.id_;
+        other.wheel_ = nullptr;
+      }
+      return *this;
+    }
+
+    ~Timer() { Cancel(); }
+
+    void Cancel() {
+      if (wheel_) {
+        wheel_->Cancel(id_);
+        wheel_ = nullptr;
+      }
+    }
+
+    bool IsActive() const { return wheel_ && wheel_->IsActive(id_); }
+
+   private:
+    TimerWheel *wheel_ = nullptr;
+    uint64_t id_ = 0;
+  };
+
+  // The slots have room for a few timers each from the start, so a periodic
+  // timer going round does not allocate
+  TimerWheel() : slots_(kSlots) {
+    for (auto& slot : slots_) {
+      slot.reserve(4);
+    }
+    due_.reserve(16);
+  }
+  TimerWheel(const TimerWheel&) = delete;
+
+  // Runs the callback once, the delay from now
+  [[nodiscard]] Timer After(Duration delay, Callback callback) { return Add(delay, Duration::zero(), std::move(callback)); }
+
+  // Runs the callback every period, the first time a period from now. A
+  // timer that falls behind catches up, it runs once for every period that
+  // has passed.
+  [[nodiscard]] Timer Every(Duration period, Callback callback) {
+    return Add(period, std::max(period, Duration(1)), std::move(callback));
+  }
+
+  // The game time that passes in the real time, none while paused
+  Duration Scale(Clock::duration real) const {
+    if (paused_) {
+      return Duration::zero();
+    }
+    return std::chrono::duration_cast<Duration>(std::chrono::duration<double, std::micro>(real) * time_scale_);
+  }
+
+  // Moves the game time on and runs the callbacks that have become due, the
+  // earliest deadline first
+  void Advance(Duration elapsed) {
+    const auto now = now_ + std::max(elapsed, Duration::zero());
+    const auto first = now_.count() / kTick.count();
+    const auto last = std::min(now.count() / kTick.count(), first + static_cast<int64_t>(kSlots) - 1);
+
+    for (auto tick = first; tick <= last; ++tick) {
+      auto& slot = slots_[tick % kSlots];
+
+      slot.erase(std::remove_if(slot.begin(), slot.end(), [&](uint64_t id) {
+        const auto it = timers_.find(id);
+
+        if (it == timers_.end()) {
+          return true; // Cancelled
+        }
+        if (it->second.deadline > now) {
+          return false; // A later revolution
+        }
+        due_.emplace_back(it->second.deadline, id);
+        std::push_heap(due_.begin(), due_.end(), std::greater<>());
+        return true;
+      }), slot.end());
+    }
+    now_ = now;
+    while (!due_.empty()) {
+      std::pop_heap(due_.begin(), due_.end(), std::greater<>());
+      const auto id = due_.back().second;
+
+      due_.pop_back();
+      auto it = timers_.find(id);
+      if (it == timers_.end()) {
+        continue;
+      }
+      auto callback = it->second.callback;
+
+      if (it->second.period > Duration::zero()) {
+        Schedule(id, it->second, it->second.deadline + it->second.period);
+      } else {
+        timers_.erase(it);
+      }
+      callback();
+    }
+  }
+
+  Duration GetTime() const { return now_; }
+
+  void SetPaused(bool paused) { paused_ = paused; }
+
+  bool IsPaused() const { return paused_; }
+
+  void SetTimeScale(double time_scale) { time_scale_ = std::max(time_scale, 0.0); }
+
+  double GetTimeScale() const { return time_scale_; }
+
+  size_t size() const { return timers_.size(); }
+
+ protected:
+  struct Entry {
+    Duration deadline;
+    Duration period; // Zero for a timer that runs once
+    Callback callback;
+  };
+
+  Timer Add(Duration delay, Duration period, Callback callback) {
+    const auto id = next_id_++;
+    auto& entry = timers_[id];
+
+    entry.period = period;
+    entry.callback = std::move(callback);
+    Schedule(id, entry, now_ + std::max(delay, Duration::zero()));
+
+    return Timer(this, id);
+  }
+
+  // A deadline that has already passed, e.g. of a timer that is behind, is
+  // due right away
+  void Schedule(uint64_t id, Entry& entry, Duration deadline) {
+    entry.deadline = deadline;
+    if (deadline <= now_) {
+      due_.emplace_back(deadline, id);
+      std::push_heap(due_.begin(), due_.end(), std::greater<>());
+    } else {
+      slots_[(deadline.count() / kTick.count()) % kSlots].push_back(id);
+    }
+  }
+
+  void Cancel(uint64_t id) { timers_.erase(id); }
+
+  bool IsActive(uint64_t id) const { return timers_.count(id) > 0; }
+
+ private:
+  Duration now_ = Duration::zero();
+  bool paused_ = false;
+  double time_scale_ = 1.0;
+  uint64_t next_id_ = 1;
+  std::unordered_map<uint64_t, Entry> timers_;
+  std::vector<std::vector<uint64_t>> slots_; // Ids by the tick of their deadline, cancelled ones are dropped when passed
+  std::vector<std::pair<Duration, uint64_t>> due_; // A heap, earliest deadline and then the oldest timer first
+};
+
+inline TimerWheel::Duration ToDuration(double seconds) {
+  return std::chrono::round<TimerWheel::Duration>(std::chrono::duration<double>(seconds));
+}
@@ -0,0 +1,48 @@
+#include "trace.h"
+
+#if defined(MIDAS_TRACE)
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+bool Tracer::Write(const std::string& file) const {
+  std::ofstream fs(file);
+
+  if (!fs) {
+    std::cout << "Failed to write trace " << file << std::endl;
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Event> events;
+  size_t count = 0;
+
+  fs << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  for (size_t thread = 0; thread < rings_.size(); ++thread) {
+    const auto& ring = *rings_[thread];
+    const uint64_t end = ring.written.load(std::memory_order_acquire);
+    const uint64_t begin = (end > kCapacity) ? end - kCapacity : 0;
+
+    events.clear();
+    for (uint64_t i = begin; i < end; ++i) {
+      events.push_back(ring.events[i % kCapacity]);
+    }
+    // The first events copied may have been overwritten while copying
+    const uint64_t written = ring.written.load(std::memory_order_acquire);
+    const uint64_t valid = (written > kCapacity) ? written - kCapacity : 0;
+
+    for (uint64_t i = std::max(begin, valid); i < end; ++i) {
+      const auto& e = events[i - begin];
+
+      fs << ((count++ > 0) ? ",\n" : "") << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread
+         << ", \"ts\": " << e.start_ns / 1000.0 << ", \"dur\": " << e.duration_ns / 1000.0 << ", \"args\": {\"frame\": " << e.frame << "}}";
+    }
+  }
+  fs << "\n]}\n";
+  std::cout << "Trace with " << count << " events written to " << file << std::endl;
+
+  return fs.good();
+}
+
+#endif
@@ -0,0 +1,121 @@
+#pragma once
+
+// Scoped trace zones, written as a Chrome trace event file that loads in
+// chrome://tracing and ui.perfetto.dev. They are only recorded when the game
+// is configured with -DMIDAS_TRACE=ON, otherwise TRACE_ZONE and TRACE_FRAME
+// compile to nothing.
+//
+//   void Grid::Generate() {
+//     TRACE_ZONE("Grid::Generate");
+//
+// TRACE_FRAME is a zone named Frame that starts a new frame number. Every
+// event carries the frame it was recorded in, so the zones of a slow frame
+// can be found from the Frame zone. Names must be string literals.
+
+#if defined(MIDAS_TRACE)
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Every thread records into a ring of its own that keeps its last kCapacity
+// events, so a zone costs two clock reads and a few stores and threads never
+// wait for each other. The lock is only taken the first time a thread
+// records and when the trace is written.
+class Tracer final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr uint64_t kCapacity = 1 << 15;
+
+  struct Event {
+    const char *name;
+    int64_t start_ns;
+    int64_t duration_ns;
+    uint64_t frame;
+  };
+
+  static Tracer& Get() {
+    static Tracer tracer;
+
+    return tracer;
+  }
+
+  void Record(const char *name, Clock::time_point start, Clock::time_point end) {
+    static thread_local Ring *ring = AddRing();
+
+    ring->Push({ name, ToNs(start), ToNs(end) - ToNs(start), frame_.load(std::memory_order_relaxed) });
+  }
+
+  void NextFrame() { frame_.fetch_add(1, std::memory_order_relaxed); }
+
+  // Writes what the rings hold, recording goes on meanwhile
+  bool Write(const std::string& file) const;
+
+ protected:
+  Tracer() : started_(Clock::now()) {}
+
+  int64_t ToNs(Clock::time_point t) const { return std::chrono::duration_cast<std::chrono::nanoseconds>(t - started_).count(); }
+
+  // Written by its thread only. A reader copies the events and then drops
+  // those the thread may have overwritten during the copy.
+  struct Ring {
+    void Push(const Event& event) {
+      const uint64_t n = written.load(std::memory_order_relaxed);
+
+      events[n % kCapacity] = event;
+      written.store(n + 1, std::memory_order_release);
+    }
+
+    std::array<Event, kCapacity> events;
+    std::atomic<uint64_t> written { 0 };
+  };
+
+  Ring *AddRing() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    rings_.emplace_back(std::make_unique<Ring>());
+
+    return rings_.back().get();
+  }
+
+ private:
+  Clock::time_point started_;
+  std::atomic<uint64_t> frame_ { 0 };
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Ring>> rings_; // Outlive their threads, so no ring is freed while written
+};
+
+class TraceZone final {
+ public:
+  explicit TraceZone(const char *name, bool new_frame = false) : name_(name) {
+    if (new_frame) {
+      Tracer::Get().NextFrame();
+    }
+    start_ = Tracer::Clock::now();
+  }
+
+  TraceZone(const TraceZone&) = delete;
+
+  ~TraceZone() { Tracer::Get().Record(name_, start_, Tracer::Clock::now()); }
+
+ private:
+  const char *name_;
+  Tracer::Clock::time_point start_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_FRAME() TraceZone TRACE_CONCAT(trace_frame_, __LINE__)("Frame", true)
+
+#else
+
+#define TRACE_ZONE(name) static_cast<void>(0)
+#define TRACE_FRAME() static_cast<void>(0)
+
+#endif
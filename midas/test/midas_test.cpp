@@ -1,26 +1,35 @@
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 
 #include "animation.h"
+#include "board_analyzer.h"
+#include "board_pool.h"
 #include "grid.h"
-
+#include "headless_asset_manager.h"
+#include "board_batch.h"
+#include "midas_engine.h"
+#include "autoplay.h"
+#include "history.h"
+#include "idle_scheduler.h"
+#include "metrics.h"
+#include "offline_audio_sink.h"
+#include "timer_wheel.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <initializer_list>
+#include <memory>
+#include <sstream>
+#include <thread>
 #include "catch.hpp"
 
 class AssetManagerMock : public AssetManagerInterface {
  public:
-  virtual std::shared_ptr<const Sprite> GetSprite() const override {
-    return std::make_shared<const Sprite>(SpriteID::Blue);
-  }
-
-  virtual std::shared_ptr<const Sprite> GetSprite(int) const override {
-    return std::make_shared<const Sprite>(SpriteID::Blue);
-  }
-
   virtual std::shared_ptr<const Sprite> GetSprite(SpriteID id) const override {
     return std::make_shared<const Sprite>(id);
   }
-
-  virtual void ResetPreviousIds() override {}
 };
 
 AssetManagerMock kAssetManagerMock;
@@ -192,3 +201,767 @@ TEST_CASE("FindPotentialMatches") {
 
   REQUIRE(matches_found == false);
 }
+
+void RemoveAndScore(Grid& grid, ScoreRules& score, const std::vector<Position>& matches, int chains) {
+  score.Update(std::set<Position>(matches.begin(), matches.end()).size(), chains);
+  RemoveMatches(grid, matches);
+}
+
+// What Board does, one Collaps per frame until nothing moves
+void CollapsEveryFrame(Grid& grid, ScoreRules& score) {
+  for (;;) {
+    auto [moved_objects, matches, chains] = grid.Collaps(score.GetConsecutiveMatchesRef(), score.GetPreviousConsecutiveMatchesRef());
+
+    if (!matches.empty()) {
+      RemoveAndScore(grid, score, matches, chains);
+    } else if (moved_objects.empty()) {
+      break;
+    }
+  }
+}
+
+bool SameBoard(const Grid& g1, const Grid& g2) {
+  for (int row = 0; row < kRows; ++row) {
+    for (int col = 0; col < kCols; ++col) {
+      if (g1.At(row, col) != g2.At(row, col)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+TEST_CASE("ResolveCascadesEqualsCollapsEveryFrame") {
+  for (uint32_t seed = 1; seed <= 10; ++seed) {
+    HeadlessAssetManager assets;
+    Grid frame(kRows, kCols, &assets, seed);
+    Grid instant(kRows, kCols, &assets, seed);
+    ScoreRules frame_score;
+    ScoreRules instant_score;
+
+    CollapsEveryFrame(frame, frame_score);
+    instant.ResolveCascades(instant_score);
+    for (int move = 0; move < 25; ++move) {
+      REQUIRE(SameBoard(frame, instant));
+
+      auto [p1, p2] = frame.FindPotentialMatches().second;
+
+      for (auto [grid, score] : { std::make_pair(&frame, &frame_score), std::make_pair(&instant, &instant_score) }) {
+        auto [matches, chains] = grid->GetMatchesFromSwap(p1, p2);
+
+        std::swap(grid->At(p1), grid->At(p2));
+        RemoveAndScore(*grid, *score, matches, chains);
+      }
+      CollapsEveryFrame(frame, frame_score);
+      instant.ResolveCascades(instant_score);
+      REQUIRE(frame_score.Get() == instant_score.Get());
+      REQUIRE(frame_score.GetConsecutiveMatchesRef() == instant_score.GetConsecutiveMatchesRef());
+    }
+  }
+}
+
+std::vector<std::vector<int>> ToGrid(const BoardBatch& batch, int board) {
+  std::vector<std::vector<int>> grid(kRows, std::vector<int>(kCols));
+
+  for (int row = 0; row < kRows; ++row) {
+    for (int col = 0; col < kCols; ++col) {
+      grid[row][col] = batch.At(board, row, col);
+    }
+  }
+  return grid;
+}
+
+int PickValidMove(const std::vector<uint8_t>& valid_moves, int board, std::mt19937& engine) {
+  std::vector<int> moves;
+
+  for (int move = 0; move < BoardBatch::kMoves; ++move) {
+    if (valid_moves[board * BoardBatch::kMoves + move]) {
+      moves.push_back(move);
+    }
+  }
+  return moves.at(std::uniform_int_distribution<size_t>(0, moves.size() - 1)(engine));
+}
+
+// A Grid with the pieces, the generator and the refills of a batch board
+std::unique_ptr<Grid> ToGrid(const BoardBatch& batch, int board, AssetManagerInterface* am) {
+  auto grid = std::make_unique<Grid>(ToGrid(batch, board), am);
+  GridSnapshot snapshot;
+
+  grid->Snapshot(snapshot);
+  snapshot.is_dirty = 0;
+  snapshot.generator = batch.GetGenerator(board).GetState();
+  batch.GetRefills(board).GetState(snapshot.refills);
+  grid->Restore(snapshot);
+
+  return grid;
+}
+
+TEST_CASE("BoardBatchAgreesWithGrid") {
+  const int kBoards = 64;
+  HeadlessAssetManager assets;
+  BoardBatch batch(kBoards, 17);
+  BoardBatch::StepResult result;
+  std::mt19937 engine(17);
+
+  batch.GetValidMoves(result.valid_moves);
+  for (int step = 0; step < 20; ++step) {
+    std::vector<int> moves(kBoards);
+    std::vector<std::unique_ptr<Grid>> grids;
+    std::vector<ScoreRules> scores;
+
+    for (int board = 0; board < kBoards; ++board) {
+      grids.push_back(ToGrid(batch, board, &assets));
+      scores.push_back(batch.GetScore(board));
+
+      auto& grid = *grids.back();
+
+      REQUIRE(grid.GetAllMatches().first.empty());
+      for (int move = 0; move < BoardBatch::kMoves; ++move) {
+        const auto [p1, p2] = BoardBatch::GetMove(move);
+        const bool match = !grid.GetMatchesFromSwap(Position(p1.first, p1.second), Position(p2.first, p2.second)).first.empty();
+
+        REQUIRE(match == (result.valid_moves[board * BoardBatch::kMoves + move] != 0));
+      }
+      // Every fourth board tries a swap without a match
+      moves[board] = (board % 4 == 0) ? -1 : PickValidMove(result.valid_moves, board, engine);
+    }
+    batch.Step(moves, result);
+    for (int board = 0; board < kBoards; ++board) {
+      auto& grid = *grids[board];
+      auto& score = scores[board];
+      int reward = 0;
+
+      if (moves[board] != -1) {
+        const auto [p1, p2] = BoardBatch::GetMove(moves[board]);
+        const Position from(p1.first, p1.second);
+        const Position to(p2.first, p2.second);
+        auto [matches, chains] = grid.GetMatchesFromSwap(from, to);
+
+        std::swap(grid.At(from), grid.At(to));
+        reward = score.Update(std::set<Position>(matches.begin(), matches.end()).size(), chains);
+        RemoveMatches(grid, matches);
+        reward += grid.ResolveCascades(score).score_delta;
+      }
+      auto batch_score = batch.GetScore(board);
+
+      REQUIRE(result.rewards[board] == reward);
+      REQUIRE((result.rewards[board] > 0) == (moves[board] != -1));
+      for (int row = 0; row < kRows; ++row) {
+        for (int col = 0; col < kCols; ++col) {
+          REQUIRE(batch.At(board, row, col) == grid.At(row, col).id());
+        }
+      }
+      REQUIRE(batch_score.Get() == score.Get());
+      REQUIRE(batch_score.GetConsecutiveMatchesRef() == score.GetConsecutiveMatchesRef());
+    }
+  }
+}
+
+TEST_CASE("BoardBatchRefillsColumnsLikeGrid") {
+  const uint32_t kSeed = 3;
+  BoardBatch batch(1, kSeed);
+  BoardBatch::StepResult result;
+  // The refill stream of column 0, seeded the way the batch seeds board 0
+  const RefillSource expected(~((static_cast<uint64_t>(kSeed) << 32) | 0));
+  std::vector<std::vector<int>> cells(kRows, std::vector<int>(kCols));
+
+  // No match anywhere except a vertical one at the top of column 0, and a
+  // move in the bottom right corner so the board is not replaced as dead
+  for (int row = 0; row < kRows; ++row) {
+    for (int col = 0; col < kCols; ++col) {
+      cells[row][col] = (row + 2 * col) % kNumSprites;
+    }
+  }
+  cells[0][0] = cells[1][0] = cells[2][0] = SpriteID::Purple;
+  cells[7][6] = cells[8][7] = cells[8][5];
+  batch.Set(0, cells);
+  batch.Step({ -1 }, result);
+
+  REQUIRE(result.rewards[0] > 0);
+  // The first piece popped ends up lowest, as with Grid::Collaps
+  REQUIRE(batch.At(0, 2, 0) == expected.Peek(0, 0));
+  REQUIRE(batch.At(0, 1, 0) == expected.Peek(0, 1));
+  REQUIRE(batch.At(0, 0, 0) == expected.Peek(0, 2));
+  for (int row = 3; row < kRows; ++row) {
+    REQUIRE(batch.At(0, row, 0) == cells[row][0]);
+  }
+}
+
+TEST_CASE("EngineStepsWithoutLeavingMatches") {
+  midas_game *game = midas_create(42);
+  std::vector<uint8_t> cells(midas_rows() * midas_cols());
+  midas_move moves[BoardBatch::kMoves];
+  midas_step_result result;
+
+  REQUIRE(game != nullptr);
+  REQUIRE(midas_copy_state(game, cells.data(), 1) == -1);
+  for (int step = 0; step < 20; ++step) {
+    const int valid_moves = midas_valid_moves(game, moves, BoardBatch::kMoves);
+    const int score = midas_score(game);
+
+    REQUIRE(valid_moves > 0);
+    REQUIRE(midas_step(game, &moves[0], &result) == 1);
+    REQUIRE(result.score_delta > 0);
+    REQUIRE(midas_score(game) == score + result.score_delta);
+    REQUIRE(midas_copy_state(game, cells.data(), static_cast<int>(cells.size())) == kRows * kCols);
+
+    std::vector<std::vector<int>> grid(kRows, std::vector<int>(kCols));
+
+    for (int i = 0; i < kRows * kCols; ++i) {
+      REQUIRE(cells[i] < SpriteID::Empty);
+      grid[i / kCols][i % kCols] = cells[i];
+    }
+    REQUIRE(Grid(grid, &kAssetManagerMock).GetAllMatches().first.empty());
+  }
+  const midas_move far_away { 0, 0, 2, 0 };
+
+  REQUIRE(midas_step(game, &far_away, &result) == -1);
+
+  // The batch takes NULL results like midas_step does
+  const int score = midas_score(game);
+
+  midas_valid_moves(game, moves, BoardBatch::kMoves);
+  midas_step_batch(&game, moves, nullptr, 1);
+  REQUIRE(midas_score(game) > score);
+  midas_step_batch(nullptr, moves, nullptr, 1);
+  midas_destroy(game);
+}
+
+TEST_CASE("SnapshotContinuesTheSameGame") {
+  midas_game *original = midas_create(7);
+  midas_game *copy = midas_create(8);
+  midas_move moves[BoardBatch::kMoves];
+  std::vector<uint8_t> snapshot(midas_snapshot_size());
+
+  for (int step = 0; step < 5; ++step) {
+    midas_valid_moves(original, moves, BoardBatch::kMoves);
+    midas_step(original, &moves[0], nullptr);
+  }
+  REQUIRE(midas_snapshot(original, snapshot.data(), 1) == -1);
+  REQUIRE(midas_snapshot(original, snapshot.data(), static_cast<int>(snapshot.size())) == midas_snapshot_size());
+  REQUIRE(midas_restore(copy, snapshot.data(), static_cast<int>(snapshot.size())) == 0);
+
+  // The refills are part of the snapshot, so both games stay the same
+  for (int step = 0; step < 20; ++step) {
+    std::vector<uint8_t> cells1(kRows * kCols);
+    std::vector<uint8_t> cells2(kRows * kCols);
+
+    midas_copy_state(original, cells1.data(), kRows * kCols);
+    midas_copy_state(copy, cells2.data(), kRows * kCols);
+    REQUIRE(cells1 == cells2);
+    REQUIRE(midas_score(original) == midas_score(copy));
+    midas_valid_moves(original, moves, BoardBatch::kMoves);
+    midas_step(original, &moves[0], nullptr);
+    midas_step(copy, &moves[0], nullptr);
+  }
+  snapshot[0] ^= 0xff;
+  REQUIRE(midas_restore(copy, snapshot.data(), static_cast<int>(snapshot.size())) == -1);
+  midas_destroy(original);
+  midas_destroy(copy);
+
+  HeadlessAssetManager assets;
+  Grid grid(kRows, kCols, &assets, 9);
+  GameSnapshot saved;
+  GameSnapshot loaded;
+  const std::string file("midas_test_snapshot.bin");
+
+  grid.Snapshot(saved.grid);
+  REQUIRE(WriteSnapshot(file, saved));
+  REQUIRE(ReadSnapshot(file, loaded));
+  std::remove(file.c_str());
+  REQUIRE(std::memcmp(&saved.grid, &loaded.grid, sizeof(GridSnapshot)) == 0);
+}
+
+void SetScoreField(GameSnapshot& snapshot, int field, int value) {
+  std::memcpy(reinterpret_cast<char *>(&snapshot.score) + field * sizeof(int), &value, sizeof(value));
+}
+
+TEST_CASE("CorruptSnapshotsAreRejected") {
+  HeadlessAssetManager assets;
+  Grid grid(kRows, kCols, &assets, 9);
+  GameSnapshot valid;
+  midas_game *game = midas_create(7);
+  const std::string file("midas_test_corrupt.bin");
+
+  grid.Snapshot(valid.grid);
+  REQUIRE(valid.IsValid());
+
+  const std::vector<std::function<void(GameSnapshot&)>> corruptions = {
+    [](GameSnapshot& s) { s.grid.fill_size = -1; },
+    [](GameSnapshot& s) { s.grid.fill_size = kRows * kCols + 1; },
+    [](GameSnapshot& s) { s.grid.cells[10] = SpriteID::Empty + 1; },
+    [](GameSnapshot& s) { s.grid.fill_size = 1; s.grid.fill[0] = 0xff; },
+    [](GameSnapshot& s) { s.grid.refills.head[3] = RefillSource::kCapacity; },
+    [](GameSnapshot& s) { s.grid.refills.head[3] = -1; },
+    [](GameSnapshot& s) { s.grid.refills.count[5] = RefillSource::kLookahead - 1; },
+    [](GameSnapshot& s) { s.grid.refills.count[5] = RefillSource::kCapacity + 1; },
+    [](GameSnapshot& s) { s.grid.refills.ring[7][0] = SpriteID::OwnedByAnimation; },
+    [](GameSnapshot& s) { s.grid.is_filling = 2; },
+    [](GameSnapshot& s) { s.grid.is_dirty = 0xff; },
+    [](GameSnapshot& s) { s.score.GetConsecutiveMatchesRef() = -1; },
+    [](GameSnapshot& s) { s.score.GetPreviousConsecutiveMatchesRef() = -1; },
+    [](GameSnapshot& s) { s.score.GetPreviousConsecutiveMatchesRef() = s.score.GetConsecutiveMatchesRef() + 1; },
+    // The rest of ScoreRules as a file holds it, the counters in declaration
+    // order followed by the threshold flag
+    [](GameSnapshot& s) { SetScoreField(s, 0, -10); },
+    [](GameSnapshot& s) { SetScoreField(s, 3, -1); },
+    [](GameSnapshot& s) { SetScoreField(s, 4, kInitialThresholdStep - 1); },
+    [](GameSnapshot& s) { reinterpret_cast<uint8_t *>(&s.score)[5 * sizeof(int)] = 2; },
+    [](GameSnapshot& s) { s.elapsed_time = -1; },
+  };
+
+  for (const auto& corrupt : corruptions) {
+    GameSnapshot snapshot = valid;
+    GameSnapshot loaded;
+
+    corrupt(snapshot);
+    REQUIRE(!snapshot.IsValid());
+    REQUIRE(midas_restore(game, &snapshot, midas_snapshot_size()) == -1);
+    REQUIRE(WriteSnapshot(file, snapshot));
+    REQUIRE(!ReadSnapshot(file, loaded));
+  }
+  std::remove(file.c_str());
+  midas_destroy(game);
+}
+
+TEST_CASE("EnumerateMovesAgreesWithFullScan") {
+  for (uint32_t seed = 1; seed <= 50; ++seed) {
+    HeadlessAssetManager assets;
+    Grid grid(kRows, kCols, &assets, seed);
+    ScoreRules score;
+
+    grid.ResolveCascades(score);
+
+    const auto moves = grid.EnumerateMoves();
+    size_t found = 0;
+
+    for (int row = 0; row < kRows; ++row) {
+      for (int col = 0; col < kCols; ++col) {
+        for (const auto& p2 : { Position(row, col + 1), Position(row + 1, col) }) {
+          if (p2.row() >= kRows || p2.col() >= kCols) {
+            continue;
+          }
+          auto [matches, chains] = grid.GetMatchesFromSwap(Position(row, col), p2);
+
+          if (matches.empty()) {
+            continue;
+          }
+          const auto& move = moves.at(found++);
+          const int unique_matches = static_cast<int>(std::set<Position>(matches.begin(), matches.end()).size());
+
+          REQUIRE((move.p1 == Position(row, col) && move.p2 == p2));
+          REQUIRE(move.matches == unique_matches);
+          REQUIRE(move.chains == chains);
+          REQUIRE(move.score == GetBasicScore(unique_matches));
+        }
+      }
+    }
+    REQUIRE(found == moves.size());
+  }
+}
+
+TEST_CASE("GetMatchesFromSwapEqualsFullScan") {
+  for (uint32_t seed = 1; seed <= 100; ++seed) {
+    HeadlessAssetManager assets;
+    Grid grid(kRows, kCols, &assets, seed);
+    ScoreRules score;
+
+    grid.ResolveCascades(score);
+    for (int row = 0; row < kRows; ++row) {
+      for (int col = 0; col < kCols; ++col) {
+        const Position p1(row, col);
+
+        for (const auto& p2 : { Position(row, col + 1), Position(row + 1, col) }) {
+          if (p2.row() >= kRows || p2.col() >= kCols) {
+            continue;
+          }
+          std::swap(grid.At(p1), grid.At(p2));
+          const auto full_scan = grid.GetAllMatches();
+          std::swap(grid.At(p1), grid.At(p2));
+
+          REQUIRE(grid.GetMatchesFromSwap(p1, p2) == full_scan);
+        }
+      }
+    }
+  }
+}
+
+// What AssetManager::GetSprite(int col) used to do
+SpriteID RejectionSample(SpriteID not_this, SpriteID nor_this, std::mt19937& engine) {
+  std::uniform_int_distribution<int> distribution(0, kNumSprites - 1);
+  SpriteID id;
+
+  do {
+    id = static_cast<SpriteID>(distribution(engine));
+  } while (id == not_this || id == nor_this);
+
+  return id;
+}
+
+TEST_CASE("PieceGeneratorDistribution") {
+  const int kDraws = 100000;
+  PieceGenerator generator(11);
+  std::mt19937 engine(11);
+
+  for (int not_this = SpriteID::Blue; not_this <= SpriteID::Empty; ++not_this) {
+    for (int nor_this = not_this; nor_this <= SpriteID::Empty; ++nor_this) {
+      std::vector<int> direct(kNumSprites);
+      std::vector<int> rejection(kNumSprites);
+
+      for (int i = 0; i < kDraws; ++i) {
+        direct.at(generator.NextExcept(static_cast<SpriteID>(not_this), static_cast<SpriteID>(nor_this)))++;
+        rejection.at(RejectionSample(static_cast<SpriteID>(not_this), static_cast<SpriteID>(nor_this), engine))++;
+      }
+      for (int id = 0; id < static_cast<int>(kNumSprites); ++id) {
+        const bool allowed = (id != not_this && id != nor_this);
+
+        REQUIRE((direct[id] > 0) == allowed);
+        REQUIRE(std::abs(direct[id] - rejection[id]) < kDraws / 100);
+      }
+    }
+  }
+}
+
+TEST_CASE("RefillSourcePeekPredictsRefills") {
+  const int kPops = 3 * RefillSource::kCapacity;
+  RefillSource forward(5);
+  RefillSource backward(5);
+  std::vector<std::vector<SpriteID>> popped(kCols);
+
+  // Columns are independent streams, the order they are popped in does not matter
+  for (int n = 0; n < kPops; ++n) {
+    for (int col = kCols - 1; col >= 0; --col) {
+      popped[col].push_back(backward.Pop(col));
+    }
+  }
+  for (int col = 0; col < kCols; ++col) {
+    std::vector<SpriteID> upcoming;
+
+    for (int n = 0; n < RefillSource::kLookahead; ++n) {
+      upcoming.push_back(forward.Peek(col, n));
+    }
+    for (int n = 0; n < kPops; ++n) {
+      const SpriteID id = forward.Pop(col);
+
+      REQUIRE(id == popped[col][n]);
+      if (n < RefillSource::kLookahead) {
+        REQUIRE(id == upcoming[n]);
+      }
+      REQUIRE(id != forward.Peek(col, 0));
+    }
+  }
+  HeadlessAssetManager assets;
+  Grid grid(kRows, kCols, &assets, 5);
+  ScoreRules score;
+
+  CollapsEveryFrame(grid, score);
+  std::vector<SpriteID> upcoming;
+
+  for (int col = 0; col < kCols; ++col) {
+    upcoming.push_back(grid.GetRefills().Peek(col, 0));
+    grid.At(0, col) = Element(assets.GetSprite(SpriteID::Empty));
+  }
+  grid.Collaps(score.GetConsecutiveMatchesRef(), score.GetPreviousConsecutiveMatchesRef());
+  for (int col = 0; col < kCols; ++col) {
+    REQUIRE(grid.At(0, col).id() == upcoming[col]);
+  }
+}
+
+TEST_CASE("MonteCarloPlayerChoosesValidMoves") {
+  WorkStealingPool pool(4);
+  std::vector<std::atomic<int>> runs(1000);
+
+  for (int round = 0; round < 10; ++round) {
+    pool.Run(static_cast<int>(runs.size()), [&](int task, int) { runs[task]++; });
+  }
+  REQUIRE(std::all_of(runs.begin(), runs.end(), [](const auto& n) { return n == 10; }));
+
+  AutoplayConfig config;
+  config.threads = 2;
+  config.budget = std::chrono::milliseconds(1);
+  MonteCarloPlayer player(config, 3);
+  HeadlessAssetManager assets;
+  Grid grid(kRows, kCols, &assets, 3);
+  ScoreRules score;
+
+  grid.ResolveCascades(score);
+  for (int move = 0; move < 10; ++move) {
+    const auto next = player.ChooseMove(grid, score);
+
+    REQUIRE(next);
+
+    auto [matches, chains] = grid.GetMatchesFromSwap(next->p1, next->p2);
+
+    REQUIRE(!matches.empty());
+    std::swap(grid.At(next->p1), grid.At(next->p2));
+    RemoveAndScore(grid, score, matches, chains);
+    grid.ResolveCascades(score);
+  }
+  REQUIRE(score.Get() > 0);
+  REQUIRE(player.GetStatistics().rollouts > 0);
+
+  // The board changes while the first search runs, its move is dropped and
+  // the move that comes back is from a second search
+  config.budget = std::chrono::milliseconds(20);
+  Autoplayer autoplayer(config);
+  std::optional<MoveEvaluation> move;
+
+  REQUIRE(!autoplayer.Poll(grid, score, 1));
+  while (!move) {
+    move = autoplayer.Poll(grid, score, 2);
+  }
+  REQUIRE(autoplayer.GetStatistics().seconds >= 0.04);
+}
+
+void PlayHintedMove(Grid& grid, ScoreRules& score) {
+  auto [p1, p2] = grid.FindPotentialMatches().second;
+  auto [matches, chains] = grid.GetMatchesFromSwap(p1, p2);
+
+  std::swap(grid.At(p1), grid.At(p2));
+  RemoveAndScore(grid, score, matches, chains);
+  grid.ResolveCascades(score);
+}
+
+std::vector<GameSnapshot> RecordGame(GameHistory& history, int moves) {
+  HeadlessAssetManager assets;
+  Grid grid(kRows, kCols, &assets, 4);
+  ScoreRules score;
+  std::vector<GameSnapshot> states(moves);
+
+  grid.ResolveCascades(score);
+  for (int move = 0; move < moves; ++move) {
+    grid.Snapshot(states[move].grid);
+    states[move].score = score;
+    states[move].elapsed_time = move;
+    history.Record(states[move]);
+    PlayHintedMove(grid, score);
+  }
+  return states;
+}
+
+TEST_CASE("GameHistoryRewindsMoves") {
+  GameHistory history;
+  const auto states = RecordGame(history, GameHistory::kCapacity + 100);
+  GameSnapshot state;
+  int last = static_cast<int>(states.size()) - 1;
+
+  // The oldest moves have been overwritten
+  REQUIRE(history.size() > GameHistory::kCapacity - GameHistory::kKeyframeInterval);
+  REQUIRE(history.size() < GameHistory::kCapacity);
+  REQUIRE(!history.Rewind(history.size() + 1, state));
+  for (int moves : { 0, 1, 5, 16, 17 }) {
+    REQUIRE(history.Rewind(moves, state));
+    last -= moves;
+    REQUIRE(std::memcmp(&state, &states[last], sizeof(state)) == 0);
+  }
+  const int oldest = last - history.size();
+
+  REQUIRE(history.Rewind(history.size(), state));
+  REQUIRE(std::memcmp(&state, &states[oldest], sizeof(state)) == 0);
+  REQUIRE(history.size() == 0);
+}
+
+TEST_CASE("MetricsCountPerFrame") {
+  auto& metrics = Metrics::Get();
+  HeadlessAssetManager asset_manager;
+  Grid grid(kRows, kCols, &asset_manager, 1);
+
+  metrics.EndFrame();
+  grid.EnumerateMoves();
+  grid.GetAllMatches();
+  metrics.Set(Metric::ActiveAnimations, 3);
+  metrics.EndFrame();
+  REQUIRE(metrics.GetLastFrame(Metric::GridScans) == 2);
+  REQUIRE(metrics.GetLastFrame(Metric::ActiveAnimations) == 3);
+
+  // A counter starts over every frame, a gauge keeps its value
+  metrics.EndFrame();
+  REQUIRE(metrics.GetLastFrame(Metric::GridScans) == 0);
+  REQUIRE(metrics.GetLastFrame(Metric::ActiveAnimations) == 3);
+}
+
+TEST_CASE("ArenaStopsGrowingAfterReset") {
+  InlineArena<64> arena;
+
+  for (int round = 0; round < 3; ++round) {
+    ArenaVector<int> values(arena);
+
+    for (int i = 0; i < 1000; ++i) {
+      values.push_back(i);
+    }
+    REQUIRE(values[999] == 999);
+    // Only the first round outgrows the arena, the reset makes room for it
+    REQUIRE((arena.GetOverflowBlocks() > 0) == (round == 0));
+    values.clear();
+    arena.Reset();
+    REQUIRE(arena.GetOverflowBlocks() == 0);
+  }
+  REQUIRE(arena.GetCapacity() >= 1000 * sizeof(int));
+}
+
+TEST_CASE("BoardAnalyzerDropsStaleResults") {
+  auto wait_for = [](BoardAnalyzer& analyzer, uint64_t version) {
+    for (;;) {
+      if (auto analysis = analyzer.Poll(version); analysis) {
+        return *analysis;
+      }
+      std::this_thread::yield();
+    }
+  };
+  HeadlessAssetManager assets;
+  Grid grid(kRows, kCols, &assets, 5);
+  ScoreRules score;
+  BoardAnalyzer analyzer(HintMode::Best, 1);
+
+  grid.ResolveCascades(score);
+
+  const auto moves = grid.EnumerateMoves();
+  const auto best = std::max_element(moves.begin(), moves.end(), [](const auto& a, const auto& b) { return a.score < b.score; });
+
+  analyzer.Request(grid, 1);
+
+  const auto analysis = wait_for(analyzer, 1);
+
+  REQUIRE(!analysis.dead);
+  REQUIRE(analysis.hint);
+  REQUIRE(analysis.hint->score == best->score);
+
+  // Every piece different, no move makes a match
+  std::vector<std::vector<int>> cells(kRows, std::vector<int>(kCols));
+
+  for (int row = 0; row < kRows; ++row) {
+    for (int col = 0; col < kCols; ++col) {
+      cells[row][col] = row * kCols + col;
+    }
+  }
+  analyzer.Request(Grid(cells, &assets), 2);
+  REQUIRE(wait_for(analyzer, 2).dead);
+  REQUIRE(!analyzer.Poll(1));
+}
+
+TEST_CASE("OfflineAudioSinkLogsOnTheMixClock") {
+  AudioConfig config;
+
+  config.backend = AudioBackend::Offline;
+  config.frequency = 1000;
+  config.channels = 1;
+  config.output_file = "midas_test_offline.wav";
+  {
+    OfflineAudioSink sink(config, 2);
+
+    sink.AddSound(Explosion, "explosion", std::vector<Sint16>(100, 1000), MIX_MAX_VOLUME);
+    sink.AddSound(MoveSuccessful, "move", std::vector<Sint16>(20, 1000), MIX_MAX_VOLUME);
+    sink.Play(0, Explosion, MIX_MAX_VOLUME, -1);
+    sink.AdvanceTime(0.05);
+    sink.Play(1, MoveSuccessful, 64, -1);
+    sink.AdvanceTime(0.025);
+    REQUIRE(!sink.IsPlaying(1));
+    sink.SetVolume(0, 32);
+    sink.Halt(-1);
+  }
+  std::ifstream events("midas_test_offline.csv");
+  std::stringstream csv;
+
+  csv << events.rdbuf();
+  REQUIRE(csv.str() ==
+          "time_ms,event,sound,voice,volume\n"
+          "0,play,explosion,0,128\n"
+          "50,play,move,1,64\n"
+          "75,volume,explosion,0,32\n"
+          "75,halt,explosion,0,0\n");
+
+  // A 44 byte header and the 75 ms that were mixed
+  std::ifstream wav("midas_test_offline.wav", std::ios::binary | std::ios::ate);
+
+  REQUIRE(wav.tellg() == 44 + 75 * 2);
+  wav.close();
+  events.close();
+  std::remove("midas_test_offline.wav");
+  std::remove("midas_test_offline.csv");
+}
+
+TEST_CASE("IdleSchedulerTakesTurns") {
+  IdleScheduler scheduler(std::chrono::microseconds(100));
+  std::vector<int> order;
+
+  for (int job = 0; job < 2; ++job) {
+    scheduler.Post([&order, job](IdleScheduler::Clock::time_point) {
+      order.push_back(job);
+      return std::count(order.begin(), order.end(), job) < 3;
+    });
+  }
+  // Less than a quantum left, nothing is started
+  scheduler.Run(IdleScheduler::Clock::now());
+  REQUIRE(order.empty());
+
+  scheduler.Run(IdleScheduler::Clock::now() + std::chrono::seconds(10));
+  REQUIRE(order == std::vector<int>({ 0, 1, 0, 1, 0, 1 }));
+  REQUIRE(!scheduler.HasJobs());
+  REQUIRE(scheduler.GetStatistics().jobs_done == 2);
+  REQUIRE(scheduler.GetStatistics().frames == 2);
+}
+
+TEST_CASE("BoardPoolHandsOutPlayableBoards") {
+  HeadlessAssetManager assets;
+  uint64_t seed = 0;
+  BoardPool pool(2, [&] { return std::make_unique<Grid>(kRows, kCols, &assets, ++seed); });
+
+  while (pool.size() < 2) {
+    std::this_thread::yield();
+  }
+  auto fresh = pool.Take();
+
+  REQUIRE(fresh);
+  REQUIRE(pool.GetStatistics().hits == 1);
+
+  std::vector<std::vector<int>> cells(kRows, std::vector<int>(kCols));
+
+  for (int row = 0; row < kRows; ++row) {
+    for (int col = 0; col < kCols; ++col) {
+      cells[row][col] = row * kCols + col;
+    }
+  }
+  Grid dead(cells, &assets);
+
+  dead.ReplaceDeadBoard(*fresh);
+  REQUIRE(!dead.EnumerateMoves().empty());
+
+  BoardPool empty(0, [&] { return std::make_unique<Grid>(kRows, kCols, &assets, 1); });
+
+  REQUIRE(!empty.Take());
+  REQUIRE(empty.GetStatistics().misses == 1);
+}
+
+TEST_CASE("TimerWheelFiresWhenDeadlinesPass") {
+  using std::chrono::milliseconds;
+  TimerWheel wheel;
+  std::vector<std::string> fired;
+  auto second = wheel.Every(std::chrono::seconds(1), [&] { fired.push_back("second"); });
+  auto once = wheel.After(milliseconds(1500), [&] { fired.push_back("once"); });
+  auto cancelled = wheel.After(milliseconds(500), [&] { fired.push_back("cancelled"); });
+
+  cancelled.Cancel();
+  wheel.Advance(milliseconds(999));
+  REQUIRE(fired.empty());
+
+  // Behind by two periods, the periodic timer catches up in deadline order
+  wheel.Advance(milliseconds(1001));
+  REQUIRE(fired == std::vector<std::string>({ "second", "once", "second" }));
+  REQUIRE(!once.IsActive());
+
+  // Paused no time passes, scaled it passes faster
+  wheel.SetPaused(true);
+  REQUIRE(wheel.Scale(std::chrono::seconds(5)) == TimerWheel::Duration::zero());
+  wheel.SetPaused(false);
+  wheel.SetTimeScale(4.0);
+  wheel.Advance(wheel.Scale(milliseconds(250)));
+  REQUIRE(fired.size() == 4);
+
+  // Ten seconds, more than a revolution of the wheel
+  second = wheel.Every(std::chrono::seconds(10), [&] { fired.push_back("ten"); });
+  wheel.Advance(std::chrono::seconds(9));
+  REQUIRE(fired.size() == 4);
+  wheel.Advance(std::chrono::seconds(1));
+  REQUIRE(fired.back() == "ten");
+  REQUIRE(wheel.size() == 1);
+}
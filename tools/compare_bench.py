@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+# Compares two midas_bench --json result files and flags the benchmarks whose
+# time per operation changed by more than the noise of the two runs
+#
+# Usage: tools/compare_bench.py baseline.json candidate.json [--threshold=5]
+
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return {(b['name'], b['corpus']): b for b in data['benchmarks']}
+
+
+def main(argv):
+    paths = [a for a in argv[1:] if not a.startswith('--')]
+    threshold = 5.0
+    for a in argv[1:]:
+        if a.startswith('--threshold='):
+            threshold = float(a.split('=', 1)[1])
+    if len(paths) != 2:
+        sys.exit('Usage: compare_bench.py baseline.json candidate.json [--threshold=<percent>]')
+    baseline = load(paths[0])
+    candidate = load(paths[1])
+    regressions = 0
+
+    print('%-32s %-12s %12s %12s %8s' % ('Benchmark', 'Corpus', 'Base ns/op', 'New ns/op', 'Change'))
+    for key, new in candidate.items():
+        old = baseline.get(key)
+        if old is None:
+            print('%-32s %-12s %12s %12.1f %8s' % (key[0], key[1], '-', new['ns_per_op'], 'new'))
+            continue
+        change = 100.0 * (new['ns_per_op'] - old['ns_per_op']) / old['ns_per_op']
+        # Two standard deviations of either run, in percent of the baseline
+        noise = 200.0 * max(old['stddev_ns'], new['stddev_ns']) / old['ns_per_op']
+        flag = ''
+        if abs(change) > max(threshold, noise):
+            flag = 'slower' if change > 0 else 'faster'
+            regressions += change > 0
+        if new['allocs_per_op'] > old['allocs_per_op'] + 0.5:
+            flag += ' +allocs'
+        # Instruction counts hardly vary between runs, a change is a change in the code
+        if 'instructions_per_op' in old and 'instructions_per_op' in new:
+            flag += ' instructions %+.1f%%' % (100.0 * (new['instructions_per_op'] - old['instructions_per_op']) / old['instructions_per_op'])
+        print('%-32s %-12s %12.1f %12.1f %+7.1f%% %s' % (key[0], key[1], old['ns_per_op'], new['ns_per_op'], change, flag))
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,27 @@
+#!/bin/bash
+# Runs midas --measure-startup repeatedly and prints the total startup time of
+# each run. Cold runs drop the page cache first, which requires root.
+#
+# Usage: tools/measure_startup.sh [runs] [cold|warm] [extra midas options...]
+#   e.g. tools/measure_startup.sh 10 cold --sdl-subsystems=minimal
+
+RUNS=${1:-5}
+MODE=${2:-warm}
+shift $(( $# < 2 ? $# : 2 ))
+MIDAS=${MIDAS:-build/midas/midas}
+OUT_DIR=${OUT_DIR:-startup-reports}
+
+mkdir -p "$OUT_DIR"
+
+for i in $(seq 1 "$RUNS"); do
+  if [ "$MODE" = "cold" ]; then
+    sync
+    if ! echo 3 > /proc/sys/vm/drop_caches 2>/dev/null; then
+      echo "Dropping the page cache failed, cold runs must be run as root" >&2
+      exit 1
+    fi
+  fi
+  REPORT="$OUT_DIR/$MODE-$i.json"
+  "$MIDAS" --measure-startup="$REPORT" "$@" > /dev/null || exit 1
+  echo "run $i: $(grep -o '"total_ms": [0-9.]*' "$REPORT" | cut -d' ' -f2) ms"
+done
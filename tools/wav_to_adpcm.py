@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+# Converts a 16-bit PCM WAV file to IMA ADPCM (WAVE_FORMAT_DVI_ADPCM), the
+# format the built-in music decoder streams from (see midas/src/music_stream.cpp)
+#
+# Usage: tools/wav_to_adpcm.py assets/sfx/music-loop.wav assets/sfx/music-loop-ima.wav
+
+import struct
+import sys
+
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+]
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8]
+BLOCK_ALIGN_PER_CHANNEL = 1024
+
+
+def read_wav(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[0:4] != b'RIFF' or data[8:12] != b'WAVE':
+        sys.exit(path + ' is not a WAV file')
+    pos = 12
+    fmt = None
+    pcm = None
+    while pos + 8 <= len(data):
+        chunk_id, size = struct.unpack('<4sI', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + size]
+        if chunk_id == b'fmt ':
+            fmt = struct.unpack('<HHIIHH', body[:16])
+        elif chunk_id == b'data':
+            pcm = body
+        pos += 8 + size + (size & 1)
+    if fmt is None or pcm is None or fmt[0] != 1 or fmt[5] != 16:
+        sys.exit(path + ' must be 16-bit PCM')
+    channels, rate = fmt[1], fmt[2]
+    samples = struct.unpack('<%dh' % (len(pcm) // 2), pcm[:len(pcm) // 2 * 2])
+    return channels, rate, [samples[c::channels] for c in range(channels)]
+
+
+class Encoder:
+    def __init__(self):
+        self.predictor = 0
+        self.index = 0
+
+    def encode(self, sample):
+        step = STEP_TABLE[self.index]
+        diff = sample - self.predictor
+        nibble = 0
+        if diff < 0:
+            nibble = 8
+            diff = -diff
+        delta = step >> 3
+        if diff >= step:
+            nibble |= 4
+            diff -= step
+            delta += step
+        step >>= 1
+        if diff >= step:
+            nibble |= 2
+            diff -= step
+            delta += step
+        step >>= 1
+        if diff >= step:
+            nibble |= 1
+            delta += step
+        self.predictor += -delta if nibble & 8 else delta
+        self.predictor = max(-32768, min(32767, self.predictor))
+        self.index = max(0, min(88, self.index + INDEX_TABLE[nibble & 7]))
+        return nibble
+
+
+def encode(channels, planes):
+    block_align = BLOCK_ALIGN_PER_CHANNEL * channels
+    samples_per_block = (block_align - 4 * channels) * 8 // (4 * channels) + 1
+    frames = len(planes[0])
+    encoders = [Encoder() for _ in range(channels)]
+    out = bytearray()
+
+    for start in range(0, frames, samples_per_block):
+        block = [plane[start:start + samples_per_block] for plane in planes]
+        block = [b + [b[-1]] * (samples_per_block - len(b)) for b in (list(p) for p in block)]
+        for c in range(channels):
+            encoders[c].predictor = block[c][0]
+            out += struct.pack('<hBB', block[c][0], encoders[c].index, 0)
+        nibbles = [[encoders[c].encode(s) for s in block[c][1:]] for c in range(channels)]
+        for group in range(0, samples_per_block - 1, 8):
+            for c in range(channels):
+                n = nibbles[c][group:group + 8]
+                out += bytes(n[i] | (n[i + 1] << 4) for i in range(0, 8, 2))
+    return block_align, samples_per_block, frames, bytes(out)
+
+
+def write_wav(path, channels, rate, block_align, samples_per_block, frames, data):
+    avg_bytes = rate * block_align // samples_per_block
+    fmt = struct.pack('<HHIIHHHH', 0x11, channels, rate, avg_bytes, block_align, 4, 2, samples_per_block)
+    fact = struct.pack('<I', frames)
+    body = (b'WAVE' + b'fmt ' + struct.pack('<I', len(fmt)) + fmt +
+            b'fact' + struct.pack('<I', len(fact)) + fact +
+            b'data' + struct.pack('<I', len(data)) + data)
+    with open(path, 'wb') as f:
+        f.write(b'RIFF' + struct.pack('<I', len(body)) + body)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit('usage: wav_to_adpcm.py <input.wav> <output.wav>')
+    channels, rate, planes = read_wav(sys.argv[1])
+    write_wav(sys.argv[2], channels, rate, *encode(channels, planes))